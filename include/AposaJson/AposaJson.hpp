@@ -14,12 +14,69 @@
 #define APOSA_JSON_H
 
 #include <string> // std::string
+#include <string_view> // std::string_view
 #include <vector> // std::vector
+#include <charconv> // std::from_chars, std::to_chars
+#include <cstdint> // uint32_t, int64_t
+#include <cfloat> // FLT_EVAL_METHOD
+#include <cmath> // std::isfinite
+#include <limits> // std::numeric_limits
+#include <cstring> // std::memcpy, std::memcmp
+#include <cstdio> // std::FILE, std::fwrite
+#include <cstdlib> // std::realloc, std::free
+#include <memory> // std::unique_ptr
+#include <new> // placement new, std::bad_alloc
+#include <stdexcept> // std::out_of_range, std::length_error
+#include <type_traits> // std::is_integral
+#include <utility> // std::move
+#include <initializer_list> // std::initializer_list
+#include <functional> // std::hash, std::less
+#include <atomic> // std::atomic
+#include <condition_variable> // std::condition_variable
+#include <deque> // std::deque
+#include <mutex> // std::mutex
+#include <thread> // std::thread
 
 #ifdef APOSA_JSON_USE_STDMAP
     #include <map> // std::map
+#endif
+
+#if !defined(APOSA_JSON_NO_SIMD) && (defined(__x86_64__) || defined(_M_X64))
+    #define APOSA_JSON_X86_64
+    #ifdef _MSC_VER
+        #include <intrin.h> // __cpuid, _BitScanForward64
+    #endif
+    #include <immintrin.h> // SSE4.2, AVX2 and PCLMUL intrinsics
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+    #define APOSA_JSON_POSIX
+    #include <cerrno> // errno, EINTR
+    #include <fcntl.h> // open
+    #include <sys/mman.h> // mmap, madvise
+    #include <sys/stat.h> // fstat
+    #include <unistd.h> // write, close
+#endif
+
+// Floating-point std::from_chars and std::to_chars are missing from libc++
+// before LLVM 17 and from older Apple toolchains. There, numbers are converted
+// with the C library in the "C" locale instead.
+#if !defined(__cpp_lib_to_chars) && !defined(APOSA_JSON_C_FLOAT_CONVERSION)
+    #define APOSA_JSON_C_FLOAT_CONVERSION
+#endif
+#ifdef APOSA_JSON_C_FLOAT_CONVERSION
+    #include <cerrno> // errno, ERANGE
+    #include <cstdlib> // strtod
+    #include <locale.h> // newlocale, _create_locale
+    #ifdef __APPLE__
+        #include <xlocale.h> // strtod_l
+    #endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+    #define APOSA_JSON_TARGET(isa) __attribute__((target(isa)))
 #else
-    #include <unordered_map> // std::unordered_map
+    #define APOSA_JSON_TARGET(isa)
 #endif
 
 #define APOSAJSON_NAMESPACE_BEGIN namespace AposaJson {
@@ -27,7 +84,7 @@
 
 APOSAJSON_NAMESPACE_BEGIN
 
-enum class JsonValueType
+enum class JsonValueType : uint8_t
 {
 	Null,
 	Boolean,
@@ -36,7 +93,7 @@ enum class JsonValueType
 	Array,
 	Object
 };
-enum class JsonNumberType
+enum class JsonNumberType : uint8_t
 {
     Int,
     Uint,
@@ -47,11 +104,199 @@ enum class JsonNumberType
     Int16,
     String
 };
+
+/**
+ * Chunked bump-pointer allocator owned by a JsonDocument.
+ *
+ * Strings, array elements and object members created while parsing are carved
+ * out of large chunks and released all at once when the arena is destroyed.
+ * Nothing allocated here is ever freed individually.
+ */
+class JsonArena
+{
+private:
+    struct Chunk
+    {
+        Chunk* next;
+        size_t size;
+    };
+
+    static const size_t kMinChunkSize = 4096;
+    static const size_t kMaxChunkSize = 1 << 20;
+
+    Chunk* _chunks;
+    char* _cursor;
+    char* _limit;
+    size_t _next_chunk_size;
+
+    void FreeChunks()
+    {
+        while (_chunks)
+        {
+            Chunk* next = _chunks->next;
+            ::operator delete(_chunks);
+            _chunks = next;
+        }
+        _cursor = _limit = nullptr;
+    }
+    void* AllocateSlow(size_t size, size_t alignment)
+    {
+        size_t chunk_size = _next_chunk_size;
+        if (chunk_size < size + alignment) chunk_size = size + alignment;
+        if (_next_chunk_size < kMaxChunkSize) _next_chunk_size *= 2;
+
+        Chunk* chunk = static_cast<Chunk*>(::operator new(sizeof(Chunk) + chunk_size));
+        chunk->next = _chunks;
+        chunk->size = chunk_size;
+        _chunks = chunk;
+        _cursor = reinterpret_cast<char*>(chunk + 1);
+        _limit = _cursor + chunk_size;
+        return Allocate(size, alignment);
+    }
+
+public:
+    JsonArena() :_chunks(nullptr), _cursor(nullptr), _limit(nullptr), _next_chunk_size(kMinChunkSize) {}
+    JsonArena(const JsonArena&) = delete;
+    JsonArena& operator=(const JsonArena&) = delete;
+    JsonArena(JsonArena&& other) noexcept
+        :_chunks(other._chunks), _cursor(other._cursor), _limit(other._limit), _next_chunk_size(other._next_chunk_size)
+    {
+        other._chunks = nullptr;
+        other._cursor = other._limit = nullptr;
+        other._next_chunk_size = kMinChunkSize;
+    }
+    JsonArena& operator=(JsonArena&& other) noexcept
+    {
+        if (this != &other)
+        {
+            FreeChunks();
+            _chunks = other._chunks;
+            _cursor = other._cursor;
+            _limit = other._limit;
+            _next_chunk_size = other._next_chunk_size;
+            other._chunks = nullptr;
+            other._cursor = other._limit = nullptr;
+            other._next_chunk_size = kMinChunkSize;
+        }
+        return *this;
+    }
+    ~JsonArena()
+    {
+        FreeChunks();
+    }
+
+    void* Allocate(size_t size, size_t alignment = alignof(uint64_t))
+    {
+        uintptr_t address = (reinterpret_cast<uintptr_t>(_cursor) + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+        char* ptr = reinterpret_cast<char*>(address);
+        if (!_cursor || ptr + size > _limit) return AllocateSlow(size, alignment);
+        _cursor = ptr + size;
+        return ptr;
+    }
+    // Releases everything allocated so far. The newest chunk, which is also the
+    // largest, is kept for reuse.
+    void Reset()
+    {
+        if (!_chunks) return;
+        Chunk* kept = _chunks;
+        _chunks = kept->next;
+        FreeChunks();
+        kept->next = nullptr;
+        _chunks = kept;
+        _cursor = reinterpret_cast<char*>(kept + 1);
+        _limit = _cursor + kept->size;
+    }
+    // Takes over the chunks of other, which is left empty. What was allocated
+    // from other stays valid and is released with this arena.
+    void Adopt(JsonArena& other)
+    {
+        if (this == &other || !other._chunks) return;
+        if (!_chunks)
+        {
+            *this = std::move(other);
+            return;
+        }
+        // Splice behind the current chunk so allocation carries on from it.
+        Chunk* tail = other._chunks;
+        while (tail->next) tail = tail->next;
+        tail->next = _chunks->next;
+        _chunks->next = other._chunks;
+        other._chunks = nullptr;
+        other._cursor = other._limit = nullptr;
+        other._next_chunk_size = kMinChunkSize;
+    }
+    const char* CopyString(const char* str, size_t length)
+    {
+        if (length == 0) return "";
+        char* chars = static_cast<char*>(Allocate(length + 1, 1));
+        std::memcpy(chars, str, length);
+        chars[length] = '\0';
+        return chars;
+    }
+};
+
+class JsonMember;
+class JsonArray;
+class JsonObject;
+
+namespace detail
+{
+
+// Objects with more members than this get a hash index next to their member
+// block; smaller ones are searched linearly, which is faster at that size.
+const uint32_t kMemberIndexThreshold = 16;
+
+inline uint32_t HashMemberKey(const char* key, size_t length)
+{
+    return static_cast<uint32_t>(std::hash<std::string_view>()(std::string_view(key, length)));
+}
+// Open-addressing table of member positions + 1 (0 marks a free slot) for a
+// block of slots members, so it is at most half full.
+inline uint32_t MemberIndexCapacity(uint32_t slots)
+{
+    uint32_t capacity = 64;
+    while (capacity < 2 * slots) capacity <<= 1;
+    return capacity;
+}
+
+// Converting a floating-point value that T cannot represent is undefined, so
+// it saturates instead: integers clamp to their range and NaN becomes 0, and
+// a double too large for a float becomes an infinity.
+template <typename T, typename F>
+T ConvertFloating(F value)
+{
+    if constexpr (std::is_integral<T>::value)
+    {
+        if (value != value) return T();
+        if (value <= static_cast<F>(std::numeric_limits<T>::min())) return std::numeric_limits<T>::min();
+        if (value >= static_cast<F>(std::numeric_limits<T>::max())) return std::numeric_limits<T>::max();
+    }
+    else if constexpr (sizeof(T) < sizeof(F))
+    {
+        if (value > static_cast<F>(std::numeric_limits<T>::max())) return std::numeric_limits<T>::infinity();
+        if (value < static_cast<F>(std::numeric_limits<T>::lowest())) return -std::numeric_limits<T>::infinity();
+    }
+    return static_cast<T>(value);
+}
+
+} // namespace detail
+
+/**
+ * A single JSON node packed into 16 bytes.
+ *
+ * The type tag selects exactly one active payload: an inline scalar, a
+ * pointer + length for strings and number strings, or a pointer + count for
+ * the elements of an array and the members of an object.
+ */
 class JsonValue
 {
 private:
-	JsonValueType _type;
-    JsonNumberType _number_type;
+    enum : uint16_t
+    {
+        kOwnedFlag = 0x0001, // payload was allocated by this value and is freed with it
+        kIndexedFlag = 0x0002 // object members are followed by a hash index
+    };
+
     union {
         int int_value;
         unsigned int uint_value;
@@ -60,23 +305,239 @@ private:
         double double_value;
         float float_value;
         short int16_value;
+        bool _boolean;
+        const char* _chars;
+        JsonValue* _elements;
+        JsonMember* _members;
     };
-    std::string number_string;
-    bool _boolean;
-    std::string _string;
-    std::vector<JsonValue> _array;
+    uint32_t _size; // string length, element count or member count
+    JsonValueType _type;
+    JsonNumberType _number_type;
+    uint16_t _flags;
 
-#ifdef APOSA_JSON_USE_STDMAP
-    std::map<std::string, JsonValue> _object;
-#else
-    std::unordered_map<std::string, JsonValue> _object;
-#endif
+    friend class JsonObject;
+    friend class JsonMemberMap;
+    friend class JsonDocument;
+    friend class JsonDocumentBuilder;
+    friend class JsonParallelArrayParser;
+
+    // _size holds string lengths up to UINT32_MAX. JsonParser and
+    // JsonPushParser reject longer input before it gets here.
+    static uint32_t StringSize(size_t length)
+    {
+        if (length > UINT32_MAX) throw std::length_error("AposaJson: string too long");
+        return static_cast<uint32_t>(length);
+    }
+    // Owned blocks grow in powers of two, so the capacity follows from the size.
+    static uint32_t BlockCapacity(uint32_t size)
+    {
+        uint32_t capacity = 4;
+        while (capacity < size) capacity <<= 1;
+        return capacity;
+    }
+    template <typename T>
+    static T* MoveBlock(T* block, uint32_t size, uint32_t capacity)
+    {
+        T* fresh = static_cast<T*>(::operator new(capacity * sizeof(T)));
+        for (uint32_t i = 0; i < size; ++i)
+        {
+            new (fresh + i) T(std::move(block[i]));
+            block[i].~T();
+        }
+        return fresh;
+    }
+    template <typename T>
+    static void DestroyBlock(T* block, uint32_t size)
+    {
+        for (uint32_t i = 0; i < size; ++i) block[i].~T();
+        ::operator delete(block);
+    }
+
+    void Reset(JsonValueType type)
+    {
+        Release();
+        _type = type;
+        _size = 0;
+        uint64t_value = 0;
+    }
+    void Release();
+    void CopyFrom(const JsonValue& other);
+    void AssignChars(const char* str, size_t length);
+    void RawMoveFrom(JsonValue& other)
+    {
+        std::memcpy(static_cast<void*>(this), static_cast<const void*>(&other), sizeof(JsonValue));
+        other._type = JsonValueType::Null;
+        other._flags = 0;
+    }
+    // Whether the payload lives in storage the value does not own: the arena
+    // of a document, or the input of a zero-copy parse. Owned blocks only ever
+    // hold values that are not borrowed, so the check does not recurse.
+    bool IsBorrowed() const
+    {
+        if (_flags & kOwnedFlag) return false;
+        switch (_type)
+        {
+        case JsonValueType::String:
+        case JsonValueType::Array:
+        case JsonValueType::Object:
+            return _size != 0;
+        case JsonValueType::Number:
+            return _number_type == JsonNumberType::String && _size != 0;
+        default:
+            return false;
+        }
+    }
+    // Takes over the payload of other as it is, borrowed or not. Only for
+    // values that stay inside the document the payload belongs to.
+    void RawAssign(JsonValue& other)
+    {
+        Release();
+        RawMoveFrom(other);
+    }
+    // Grows values to capacity without detaching them, for the same reason.
+    static void RawReserve(std::vector<JsonValue>& values, size_t capacity)
+    {
+        std::vector<JsonValue> grown;
+        grown.reserve(capacity);
+        for (JsonValue& value : values) grown.emplace_back().RawMoveFrom(value);
+        values.swap(grown);
+    }
+    // Makes sure the block is heap-owned and has room for one more item. Blocks
+    // living in an arena are moved out before they are modified.
+    template <typename T>
+    T* ReserveBlock(T* block)
+    {
+        if ((_flags & kOwnedFlag) && _size < BlockCapacity(_size)) return block;
+        T* fresh = MoveBlock(block, _size, BlockCapacity(_size + 1));
+        if (_flags & kOwnedFlag) ::operator delete(block);
+        _flags |= kOwnedFlag;
+        return fresh;
+    }
+    // Moves a member block out of the arena so its members can be modified in
+    // place; arena blocks are never destroyed, so anything written there leaks.
+    void OwnMembers()
+    {
+        if ((_flags & kOwnedFlag) || _size == 0) return;
+        ReserveMembers(_size);
+        if (MemberSlots() > detail::kMemberIndexThreshold) BuildMemberIndex();
+    }
+    static JsonValue* ArenaBlock(JsonValue* items, size_t count, JsonArena& arena)
+    {
+        if (count == 0) return nullptr;
+        JsonValue* block = static_cast<JsonValue*>(arena.Allocate(count * sizeof(JsonValue), alignof(JsonValue)));
+        for (size_t i = 0; i < count; ++i) (new (block + i) JsonValue())->RawMoveFrom(items[i]);
+        return block;
+    }
+
+    // Arena-backed setters used by the parser. The value does not own the
+    // storage, so the arena has to outlive it.
+    void SetString(const char* str, size_t length, JsonArena& arena)
+    {
+        Reset(JsonValueType::String);
+        _size = StringSize(length);
+        _chars = arena.CopyString(str, length);
+    }
+    // Used by zero-copy parsing: the value points into a buffer the caller
+    // keeps alive, and the text is not NUL-terminated.
+    void SetStringView(const char* str, size_t length)
+    {
+        Reset(JsonValueType::String);
+        _size = StringSize(length);
+        _chars = str;
+    }
+    void SetArray(JsonValue* elements, size_t count, JsonArena& arena)
+    {
+        Reset(JsonValueType::Array);
+        _elements = ArenaBlock(elements, count, arena);
+        _size = static_cast<uint32_t>(count);
+    }
+    void SetObject(JsonValue* pairs, size_t count, JsonArena& arena);
+    JsonMember* FindMember(const char* key, size_t length);
+    JsonValue& AppendMember(std::string_view key, JsonValue&& value);
+    void ReserveMembers(uint32_t count);
+    static size_t MemberBlockBytes(uint32_t slots);
+    // Member slots in the block: _size for arena blocks, BlockCapacity(_size)
+    // for owned ones. Blocks of more than kMemberIndexThreshold slots have
+    // room for an index behind the slots.
+    uint32_t MemberSlots() const
+    {
+        return (_flags & kOwnedFlag) ? BlockCapacity(_size) : _size;
+    }
+    uint32_t* MemberIndex() const;
+    void BuildMemberIndex();
+    void IndexMember(uint32_t position);
+
+    // Converts a number stored in any of the binary representations.
+    template <typename T>
+    T GetNumber() const
+    {
+        switch (_number_type)
+        {
+        case JsonNumberType::Int: return static_cast<T>(int_value);
+        case JsonNumberType::Uint: return static_cast<T>(uint_value);
+        case JsonNumberType::Int64: return static_cast<T>(int64t_value);
+        case JsonNumberType::Uint64: return static_cast<T>(uint64t_value);
+        case JsonNumberType::Double: return detail::ConvertFloating<T>(double_value);
+        case JsonNumberType::Float: return detail::ConvertFloating<T>(float_value);
+        case JsonNumberType::Int16: return static_cast<T>(int16_value);
+        default: return T();
+        }
+    }
 
 public:
-	JsonValue() :_type(JsonValueType::Null) {}
-	JsonValue(JsonValueType type) :_type(type) {}
+	JsonValue() :_size(0), _type(JsonValueType::Null), _number_type(JsonNumberType::Int), _flags(0)
+    {
+        uint64t_value = 0;
+    }
+	JsonValue(JsonValueType type) :_size(0), _type(type), _number_type(JsonNumberType::Int), _flags(0)
+    {
+        uint64t_value = 0;
+        if (type == JsonValueType::String) _chars = "";
+    }
+    JsonValue(const JsonValue& other) :_size(0), _type(JsonValueType::Null), _number_type(JsonNumberType::Int), _flags(0)
+    {
+        CopyFrom(other);
+    }
+    // Moving a value out of a document copies a borrowed payload into storage
+    // of its own, so the value stays valid after the document is gone. The
+    // copy leaves other null, like any other move.
+    JsonValue(JsonValue&& other) noexcept
+    {
+        if (other.IsBorrowed())
+        {
+            CopyFrom(other);
+            other._type = JsonValueType::Null;
+        }
+        else RawMoveFrom(other);
+    }
+    ~JsonValue()
+    {
+        Release();
+    }
+
+    JsonValue& operator=(const JsonValue& other)
+    {
+        if (this != &other)
+        {
+            JsonValue copy(other);
+            Release();
+            RawMoveFrom(copy);
+        }
+        return *this;
+    }
+    JsonValue& operator=(JsonValue&& other) noexcept
+    {
+        if (this != &other)
+        {
+            // other may live inside our own payload, so detach it before releasing.
+            JsonValue moved(std::move(other));
+            Release();
+            RawMoveFrom(moved);
+        }
+        return *this;
+    }
 
-	JsonValueType GetType() const 
+	JsonValueType GetType() const
 	{
 		return _type;
 	}
@@ -87,626 +548,4859 @@ public:
 
     void SetBoolean(bool value)
     {
-        _type = JsonValueType::Boolean;
+        Reset(JsonValueType::Boolean);
         _boolean = value;
     }
-    bool GetBoolean() const 
+    bool GetBoolean() const
     {
         return _boolean;
     }
 
     void SetNumberString(const std::string& value)
     {
+        Reset(JsonValueType::Number);
         _number_type = JsonNumberType::String;
-        number_string = value;
+        AssignChars(value.data(), value.size());
     }
     std::string GetNumberString() const
     {
-        return number_string;
+        if (_number_type != JsonNumberType::String) return std::string();
+        return std::string(_chars, _size);
+    }
+    // Like GetNumberString() without the copy. Valid until the value changes.
+    std::string_view GetNumberStringView() const
+    {
+        if (_number_type != JsonNumberType::String) return std::string_view();
+        return std::string_view(_chars, _size);
     }
     void SetInt(const int value)
     {
-        _type = JsonValueType::Number;
+        Reset(JsonValueType::Number);
         _number_type = JsonNumberType::Int;
         int_value = value;
     }
     int GetInt() const
     {
-        if (_number_type == JsonNumberType::String) return(std::stoi(number_string));
-        return int_value;
+        if (_number_type == JsonNumberType::String) return(std::stoi(GetNumberString()));
+        return GetNumber<int>();
     }
     void SetUint(const unsigned int value)
     {
-        _type = JsonValueType::Number;
+        Reset(JsonValueType::Number);
         _number_type = JsonNumberType::Uint;
         uint_value = value;
     }
     unsigned int GetUint() const
     {
-        if (_number_type == JsonNumberType::String) return(std::stoul(number_string));
-        return uint_value;
+        if (_number_type == JsonNumberType::String) return(std::stoul(GetNumberString()));
+        return GetNumber<unsigned int>();
     }
     void SetInt64(const int64_t value)
     {
-        _type = JsonValueType::Number;
+        Reset(JsonValueType::Number);
         _number_type = JsonNumberType::Int64;
         int64t_value = value;
     }
     int64_t GetInt64() const
     {
-        if (_number_type == JsonNumberType::String) return(std::stoll(number_string));
-        return int64t_value;
+        if (_number_type == JsonNumberType::String) return(std::stoll(GetNumberString()));
+        return GetNumber<int64_t>();
     }
     void SetUint64(const uint64_t value)
     {
-        _type = JsonValueType::Number;
+        Reset(JsonValueType::Number);
         _number_type = JsonNumberType::Uint64;
         uint64t_value = value;
     }
     uint64_t GetUint64() const
     {
-        if (_number_type == JsonNumberType::String) return(std::stoull(number_string));
-        return uint64t_value;
+        if (_number_type == JsonNumberType::String) return(std::stoull(GetNumberString()));
+        return GetNumber<uint64_t>();
     }
     void SetDouble(const double value)
     {
-        _type = JsonValueType::Number;
+        Reset(JsonValueType::Number);
         _number_type = JsonNumberType::Double;
         double_value = value;
     }
     double GetDouble() const
     {
-        if (_number_type == JsonNumberType::String) return(std::stod(number_string));
-        return double_value;
+        if (_number_type == JsonNumberType::String) return(std::stod(GetNumberString()));
+        return GetNumber<double>();
     }
     void SetFloat(const float value)
     {
-        _type = JsonValueType::Number;
+        Reset(JsonValueType::Number);
         _number_type = JsonNumberType::Float;
         float_value = value;
     }
     float GetFloat() const
     {
-        if (_number_type == JsonNumberType::String) return(std::stof(number_string));
-        return float_value;
+        if (_number_type == JsonNumberType::String) return(std::stof(GetNumberString()));
+        return GetNumber<float>();
     }
     void SetInt16(const short value)
     {
-        _type = JsonValueType::Number;
+        Reset(JsonValueType::Number);
         _number_type = JsonNumberType::Int16;
         int16_value = value;
     }
     short GetInt16() const
     {
-        if (_number_type == JsonNumberType::String) return(std::stoi(number_string));
-        return int16_value;
+        if (_number_type == JsonNumberType::String) return(std::stoi(GetNumberString()));
+        return GetNumber<short>();
     }
 
-    void SetString(const std::string& value) 
+    // Throws std::length_error for strings of 4 GiB or more.
+    void SetString(const std::string& value)
     {
-        _type = JsonValueType::String;
-        _string = value;
+        Reset(JsonValueType::String);
+        AssignChars(value.data(), value.size());
     }
-    const std::string& GetString() const 
+    // Returns a copy of the text; GetStringView() does not copy.
+    std::string GetString() const
     {
-        return _string;
+        if (_type != JsonValueType::String) return std::string();
+        return std::string(_chars, _size);
     }
-
-    void AddElement(const JsonValue& value) 
+    // Like GetString() without the copy. Valid until the value changes.
+    std::string_view GetStringView() const
     {
-        _type = JsonValueType::Array;
-        _array.push_back(value);
+        if (_type != JsonValueType::String) return std::string_view();
+        return std::string_view(_chars, _size);
     }
-    const std::vector<JsonValue>& GetArray() const 
+    size_t GetStringLength() const
     {
-        return _array;
+        return _type == JsonValueType::String ? _size : 0;
     }
 
-    void AddMember(const std::string& key, const JsonValue& value) 
-    {
-        _type = JsonValueType::Object;
-        _object[key] = value;
-    }
+    // Values moved in from a parsed document are detached from it, see
+    // JsonValue(JsonValue&&), so this value does not depend on that document.
+    void AddElement(const JsonValue& value);
+    void AddElement(JsonValue&& value);
+    // Appends an element constructed from args and returns it. The reference
+    // is valid until the array grows again.
+    template <typename... Args>
+    JsonValue& EmplaceElement(Args&&... args);
+    JsonArray GetArray() const;
 
-#ifdef APOSA_JSON_USE_STDMAP
-    const std::map<std::string, JsonValue>& GetObject() const
-    {
-        return _object;
-    }
-#else
-    const std::unordered_map<std::string, JsonValue>& GetObject() const
+    void AddMember(const std::string& key, const JsonValue& value);
+    void AddMember(const std::string& key, JsonValue&& value);
+    // Sets the member key to a value constructed from args, replacing an
+    // existing one, and returns it. Valid until the object grows again.
+    template <typename... Args>
+    JsonValue& EmplaceMember(std::string_view key, Args&&... args);
+    // Like EmplaceMember, but leaves an existing member alone and does not
+    // construct a value for it. The flag tells whether a member was added.
+    template <typename... Args>
+    std::pair<JsonValue*, bool> TryEmplaceMember(std::string_view key, Args&&... args);
+    JsonObject GetObject() const;
+};
+
+/**
+ * A key/value pair of an object value. The key is always a string value;
+ * GetKey() reads it the way code written against std::string keys expects.
+ */
+class JsonMember
+{
+public:
+    JsonValue first;
+    JsonValue second;
+
+    std::string_view GetKey() const
     {
-        return _object;
+        return first.GetStringView();
     }
-#endif
 };
-class JsonDocument
+
+/**
+ * Read-only view over the elements of an array value.
+ */
+class JsonArray
 {
 private:
-#ifdef APOSA_JSON_USE_STDMAP
-    std::map<std::string, JsonValue> _map;
-#else
-    std::unordered_map<std::string, JsonValue> _map;
-#endif
+    const JsonValue* _elements;
+    uint32_t _size;
 
 public:
-	JsonDocument() {}
+    typedef const JsonValue* const_iterator;
+    typedef const_iterator iterator;
 
-	void AddMember(const std::string& key, const JsonValue& value)
-	{
-		_map[key] = value;
-	}
+    JsonArray() :_elements(nullptr), _size(0) {}
+    JsonArray(const JsonValue* elements, uint32_t size) :_elements(elements), _size(size) {}
 
-#ifdef APOSA_JSON_USE_STDMAP
-    std::map<std::string, JsonValue> GetMember() const
+    const_iterator begin() const { return _elements; }
+    const_iterator end() const { return _elements + _size; }
+    size_t size() const { return _size; }
+    bool empty() const { return _size == 0; }
+
+    const JsonValue& operator[](size_t index) const
     {
-        return _map;
+        return _elements[index];
     }
-#else
-    std::unordered_map<std::string, JsonValue> GetMember() const
+    const JsonValue& at(size_t index) const
     {
-        return _map;
+        if (index >= _size) throw std::out_of_range("AposaJson: array index out of range");
+        return _elements[index];
     }
-#endif
-
-	JsonValue& operator[](const std::string key)
-	{
-		return _map[key];
-	}
 };
 
-class JsonSerializer
+/**
+ * Read-only view over the members of an object value, in insertion order.
+ */
+class JsonObject
 {
 private:
-    void GenKey(std::string& tmp_str, const std::string& key)
+    const JsonMember* _members;
+    uint32_t _size;
+    const uint32_t* _index; // see JsonValue::MemberIndex(); null for small objects
+    uint32_t _index_mask;
+
+    static bool KeyEquals(const JsonValue& name, const char* key, size_t length)
     {
-        tmp_str += "\"" + key + "\":";
+        return name._size == length && std::memcmp(name._chars, key, length) == 0;
     }
 
-    void GenArray(std::string& tmp_str, const JsonValue& value)
+    const JsonMember* FindIndexed(const char* key, size_t length) const
     {
-        const auto& arr = value.GetArray();
-        tmp_str += "[";
-        int i = 0;
-        for (const auto& item : arr)
+        for (uint32_t slot = detail::HashMemberKey(key, length) & _index_mask; _index[slot] != 0; slot = (slot + 1) & _index_mask)
         {
-            switch (item.GetType())
-            {
-            case JsonValueType::Null:
-                tmp_str += "null";
-                break;
-
-            case JsonValueType::Boolean:
-                tmp_str += item.GetBoolean() ? "true" : "false";
-                break;
+            const JsonMember* member = _members + _index[slot] - 1;
+            if (KeyEquals(member->first, key, length)) return member;
+        }
+        return _members + _size;
+    }
 
-            case JsonValueType::Number:
-                switch (item.GetNumberType())
-                {
-                case JsonNumberType::Int:
-                    tmp_str += std::to_string(item.GetInt());
-                    break;
-                case JsonNumberType::Uint:
-                    tmp_str += std::to_string(item.GetUint());
-                    break;
-                case JsonNumberType::Int64:
-                    tmp_str += std::to_string(item.GetInt64());
-                    break;
-                case JsonNumberType::Uint64:
-                    tmp_str += std::to_string(item.GetUint64());
-                    break;
-                case JsonNumberType::Double:
-                    tmp_str += std::to_string(item.GetDouble());
-                    break;
-                case JsonNumberType::Float:
-                    tmp_str += std::to_string(item.GetFloat());
-                    break;
-                case JsonNumberType::Int16:
-                    tmp_str += std::to_string(item.GetInt16());
-                    break;
-                case JsonNumberType::String:
-                    tmp_str += item.GetNumberString();
-                    break;
-                }
-                break;
+public:
+    typedef const JsonMember* const_iterator;
+    typedef const_iterator iterator;
 
-            case JsonValueType::String:
-                tmp_str += "\"" + item.GetString() + "\"";
-                break;
+    JsonObject() :_members(nullptr), _size(0), _index(nullptr), _index_mask(0) {}
+    JsonObject(const JsonMember* members, uint32_t size, const uint32_t* index = nullptr, uint32_t index_mask = 0)
+        :_members(members), _size(size), _index(index), _index_mask(index_mask) {}
 
-            case JsonValueType::Array:
-                GenArray(tmp_str, item);
-                break;
+    const_iterator begin() const { return _members; }
+    const_iterator end() const { return _members + _size; }
+    size_t size() const { return _size; }
+    bool empty() const { return _size == 0; }
 
-            case JsonValueType::Object:
-                GenObject(tmp_str, item);
-                break;  
-            }
-            if (++i < arr.size()) tmp_str += ",";
+    const_iterator find(const char* key, size_t length) const
+    {
+        if (_index) return FindIndexed(key, length);
+        // Parsed objects keep duplicate keys; like a map, the last one wins.
+        for (const JsonMember* member = _members + _size; member != _members;)
+        {
+            --member;
+            if (KeyEquals(member->first, key, length)) return member;
         }
-        tmp_str += "]";
+        return end();
     }
-    void GenObject(std::string& tmp_str, const JsonValue& obj)
+    const_iterator find(std::string_view key) const
     {
-        const auto& members = obj.GetObject();
-        tmp_str += "{";
-        int i = 0;
-        for (auto const& member : members)
-        {
-            GenKey(tmp_str, member.first);
-            switch (member.second.GetType())
-            {
-            case JsonValueType::Null:
-                tmp_str += "null";
-                break;
-
-            case JsonValueType::Boolean:
-                tmp_str += member.second.GetBoolean() ? "true" : "false";
-                break;
-
-            case JsonValueType::Number:
-                switch (member.second.GetNumberType())
-                {
-                case JsonNumberType::Int:
-                    tmp_str += std::to_string(member.second.GetInt());
-                    break;
-                case JsonNumberType::Uint:
-                    tmp_str += std::to_string(member.second.GetUint());
-                    break;
-                case JsonNumberType::Int64:
-                    tmp_str += std::to_string(member.second.GetInt64());
-                    break;
-                case JsonNumberType::Uint64:
-                    tmp_str += std::to_string(member.second.GetUint64());
-                    break;
-                case JsonNumberType::Double:
-                    tmp_str += std::to_string(member.second.GetDouble());
-                    break;
-                case JsonNumberType::Float:
-                    tmp_str += std::to_string(member.second.GetFloat());
-                    break;
-                case JsonNumberType::Int16:
-                    tmp_str += std::to_string(member.second.GetInt16());
-                    break;
-                case JsonNumberType::String:
-                    tmp_str += member.second.GetNumberString();
-                    break;
-                }
-                break;
+        return find(key.data(), key.size());
+    }
+    const_iterator find(const char* key) const
+    {
+        return find(key, std::strlen(key));
+    }
+    size_t count(std::string_view key) const
+    {
+        return find(key) != end() ? 1 : 0;
+    }
+    const JsonValue& at(std::string_view key) const
+    {
+        const_iterator member = find(key);
+        if (member == end()) throw std::out_of_range("AposaJson: object key not found");
+        return member->second;
+    }
+    // The member named key, or a null value when there is none.
+    const JsonValue& operator[](std::string_view key) const;
+};
 
-            case JsonValueType::String:
-                tmp_str += "\"" + member.second.GetString() + "\"";
-                break;
+// Allocation size of a member block, with room for the index when the
+// block calls for one.
+inline size_t JsonValue::MemberBlockBytes(uint32_t slots)
+{
+    size_t bytes = slots * sizeof(JsonMember);
+    if (slots > detail::kMemberIndexThreshold) bytes += detail::MemberIndexCapacity(slots) * sizeof(uint32_t);
+    return bytes;
+}
 
-            case JsonValueType::Array:
-                GenArray(tmp_str, member.second);
-                break;
+inline uint32_t* JsonValue::MemberIndex() const
+{
+    if (!(_flags & kIndexedFlag)) return nullptr;
+    return reinterpret_cast<uint32_t*>(_members + MemberSlots());
+}
 
-            case JsonValueType::Object:
-                GenObject(tmp_str, member.second);
-                break;
-            }
-            if (++i < members.size()) tmp_str += ",";
+inline void JsonValue::Release()
+{
+    if (_flags & kOwnedFlag)
+    {
+        switch (_type)
+        {
+        case JsonValueType::Number:
+        case JsonValueType::String:
+            delete[] _chars;
+            break;
+        case JsonValueType::Array:
+            DestroyBlock(_elements, _size);
+            break;
+        case JsonValueType::Object:
+            DestroyBlock(_members, _size);
+            break;
+        default:
+            break;
         }
-        tmp_str += "}";
     }
+    _flags = 0;
+}
 
-public:
-    JsonSerializer() {}
+inline void JsonValue::AssignChars(const char* str, size_t length)
+{
+    _size = StringSize(length);
+    if (length == 0)
+    {
+        _chars = "";
+        return;
+    }
+    char* chars = new char[length + 1];
+    std::memcpy(chars, str, length);
+    chars[length] = '\0';
+    _chars = chars;
+    _flags |= kOwnedFlag;
+}
 
-    std::string SerializeObject(const JsonDocument& doc)
+inline void JsonValue::CopyFrom(const JsonValue& other)
+{
+    _type = other._type;
+    _number_type = other._number_type;
+    _size = 0;
+    _flags = 0;
+    switch (other._type)
     {
-        const auto& members = doc.GetMember();
+    case JsonValueType::String:
+        AssignChars(other._chars, other._size);
+        break;
 
-        std::string tmp_result;
-        tmp_result += "{";
+    case JsonValueType::Number:
+        if (other._number_type == JsonNumberType::String) AssignChars(other._chars, other._size);
+        else uint64t_value = other.uint64t_value;
+        break;
 
-        int i = 0;
-        for (auto const& member : members)
+    case JsonValueType::Array:
+        _elements = nullptr;
+        if (other._size > 0)
         {
-            switch (member.second.GetType())
-            {
-            case JsonValueType::Null:
-                GenKey(tmp_result, member.first);
-                tmp_result += "null";
-                break;
+            _elements = static_cast<JsonValue*>(::operator new(BlockCapacity(other._size) * sizeof(JsonValue)));
+            for (; _size < other._size; ++_size) new (_elements + _size) JsonValue(other._elements[_size]);
+            _flags |= kOwnedFlag;
+        }
+        break;
 
-            case JsonValueType::Boolean:
-                GenKey(tmp_result, member.first);
-                tmp_result += member.second.GetBoolean() ? "true" : "false";
-                break;
+    case JsonValueType::Object:
+        _members = nullptr;
+        if (other._size > 0)
+        {
+            _members = static_cast<JsonMember*>(::operator new(MemberBlockBytes(BlockCapacity(other._size))));
+            for (; _size < other._size; ++_size) new (_members + _size) JsonMember(other._members[_size]);
+            _flags |= kOwnedFlag;
+            if (MemberSlots() > detail::kMemberIndexThreshold) BuildMemberIndex();
+        }
+        break;
 
-            case JsonValueType::Number:
-                GenKey(tmp_result, member.first);
-                switch (member.second.GetNumberType())
-                {
-                case JsonNumberType::Int:
-                    tmp_result += std::to_string(member.second.GetInt());
-                    break;
-                case JsonNumberType::Uint:
-                    tmp_result += std::to_string(member.second.GetUint());
-                    break;
-                case JsonNumberType::Int64:
-                    tmp_result += std::to_string(member.second.GetInt64());
-                    break;
-                case JsonNumberType::Uint64:
-                    tmp_result += std::to_string(member.second.GetUint64());
-                    break;
-                case JsonNumberType::Double:
-                    tmp_result += std::to_string(member.second.GetDouble());
-                    break;
-                case JsonNumberType::Float:
-                    tmp_result += std::to_string(member.second.GetFloat());
-                    break;
-                case JsonNumberType::Int16:
-                    tmp_result += std::to_string(member.second.GetInt16());
-                    break;
-                case JsonNumberType::String:
-                    tmp_result += member.second.GetNumberString();
+    default:
+        uint64t_value = other.uint64t_value;
+        break;
+    }
+}
+
+inline void JsonValue::AddElement(const JsonValue& value)
+{
+    EmplaceElement(value);
+}
+
+inline void JsonValue::AddElement(JsonValue&& value)
+{
+    EmplaceElement(std::move(value));
+}
+
+template <typename... Args>
+inline JsonValue& JsonValue::EmplaceElement(Args&&... args)
+{
+    // Build the element first: args may refer into the block being moved.
+    JsonValue element(std::forward<Args>(args)...);
+    if (_type != JsonValueType::Array) Reset(JsonValueType::Array);
+    _elements = ReserveBlock(_elements);
+    JsonValue* slot = new (_elements + _size) JsonValue(std::move(element));
+    _size++;
+    return *slot;
+}
+
+inline JsonArray JsonValue::GetArray() const
+{
+    if (_type != JsonValueType::Array) return JsonArray();
+    return JsonArray(_elements, _size);
+}
+
+inline void JsonValue::AddMember(const std::string& key, const JsonValue& value)
+{
+    EmplaceMember(key, value);
+}
+
+inline void JsonValue::AddMember(const std::string& key, JsonValue&& value)
+{
+    EmplaceMember(key, std::move(value));
+}
+
+template <typename... Args>
+inline JsonValue& JsonValue::EmplaceMember(std::string_view key, Args&&... args)
+{
+    JsonValue value(std::forward<Args>(args)...);
+    if (_type != JsonValueType::Object) Reset(JsonValueType::Object);
+    else
+    {
+        OwnMembers();
+        if (JsonMember* member = FindMember(key.data(), key.size()))
+        {
+            member->second = std::move(value);
+            return member->second;
+        }
+    }
+    return AppendMember(key, std::move(value));
+}
+
+template <typename... Args>
+inline std::pair<JsonValue*, bool> JsonValue::TryEmplaceMember(std::string_view key, Args&&... args)
+{
+    if (_type == JsonValueType::Object)
+    {
+        // The caller may modify an existing member through the pointer.
+        OwnMembers();
+        if (JsonMember* member = FindMember(key.data(), key.size())) return { &member->second, false };
+    }
+    JsonValue value(std::forward<Args>(args)...);
+    if (_type != JsonValueType::Object) Reset(JsonValueType::Object);
+    return { &AppendMember(key, std::move(value)), true };
+}
+
+inline JsonMember* JsonValue::FindMember(const char* key, size_t length)
+{
+    const JsonObject object = GetObject();
+    const JsonMember* member = object.find(key, length);
+    return member != object.end() ? _members + (member - _members) : nullptr;
+}
+
+inline JsonValue& JsonValue::AppendMember(std::string_view key, JsonValue&& value)
+{
+    ReserveMembers(_size + 1);
+    JsonMember* member = new (_members + _size) JsonMember();
+    member->first._type = JsonValueType::String;
+    member->first.AssignChars(key.data(), key.size());
+    member->second = std::move(value);
+    _size++;
+    // A grown block has lost its index; rebuilding it once per doubling keeps
+    // appends amortized constant.
+    if (_flags & kIndexedFlag) IndexMember(_size - 1);
+    else if (MemberSlots() > detail::kMemberIndexThreshold) BuildMemberIndex();
+    return member->second;
+}
+
+// Makes the member block heap-owned with room for count members. A block
+// that has to be reallocated drops its index; the caller rebuilds it once
+// _size matches the new block.
+inline void JsonValue::ReserveMembers(uint32_t count)
+{
+    if ((_flags & kOwnedFlag) && count <= BlockCapacity(_size)) return;
+    JsonMember* fresh = static_cast<JsonMember*>(::operator new(MemberBlockBytes(BlockCapacity(count))));
+    for (uint32_t i = 0; i < _size; ++i)
+    {
+        new (fresh + i) JsonMember(std::move(_members[i]));
+        _members[i].~JsonMember();
+    }
+    if (_flags & kOwnedFlag) ::operator delete(_members);
+    _members = fresh;
+    _flags = kOwnedFlag;
+}
+
+// pairs holds count keys, each followed by its value.
+inline void JsonValue::SetObject(JsonValue* pairs, size_t count, JsonArena& arena)
+{
+    Reset(JsonValueType::Object);
+    if (count == 0) return;
+    const uint32_t size = static_cast<uint32_t>(count);
+    JsonMember* block = static_cast<JsonMember*>(arena.Allocate(MemberBlockBytes(size), alignof(JsonMember)));
+    for (size_t i = 0; i < count; ++i)
+    {
+        JsonMember* member = new (block + i) JsonMember();
+        member->first.RawMoveFrom(pairs[2 * i]);
+        member->second.RawMoveFrom(pairs[2 * i + 1]);
+    }
+    _members = block;
+    _size = size;
+    if (size > detail::kMemberIndexThreshold) BuildMemberIndex();
+}
+
+// Fills the index behind the member slots. Later duplicates of a key replace
+// the earlier ones, so lookups agree with the linear search.
+inline void JsonValue::BuildMemberIndex()
+{
+    uint32_t* index = reinterpret_cast<uint32_t*>(_members + MemberSlots());
+    const uint32_t mask = detail::MemberIndexCapacity(MemberSlots()) - 1;
+    std::memset(index, 0, (mask + 1) * sizeof(uint32_t));
+    for (uint32_t i = 0; i < _size; ++i)
+    {
+        const JsonValue& name = _members[i].first;
+        uint32_t slot = detail::HashMemberKey(name._chars, name._size) & mask;
+        while (index[slot] != 0)
+        {
+            const JsonValue& other = _members[index[slot] - 1].first;
+            if (other._size == name._size && std::memcmp(other._chars, name._chars, name._size) == 0) break;
+            slot = (slot + 1) & mask;
+        }
+        index[slot] = i + 1;
+    }
+    _flags |= kIndexedFlag;
+}
+
+// Adds a member whose key is not in the index yet.
+inline void JsonValue::IndexMember(uint32_t position)
+{
+    uint32_t* index = MemberIndex();
+    const uint32_t mask = detail::MemberIndexCapacity(MemberSlots()) - 1;
+    const JsonValue& name = _members[position].first;
+    uint32_t slot = detail::HashMemberKey(name._chars, name._size) & mask;
+    while (index[slot] != 0) slot = (slot + 1) & mask;
+    index[slot] = position + 1;
+}
+
+inline JsonObject JsonValue::GetObject() const
+{
+    if (_type != JsonValueType::Object) return JsonObject();
+    return JsonObject(_members, _size, MemberIndex(), detail::MemberIndexCapacity(MemberSlots()) - 1);
+}
+
+static_assert(sizeof(JsonValue) == 16, "JsonValue must stay 16 bytes");
+
+inline const JsonValue& JsonObject::operator[](std::string_view key) const
+{
+    static const JsonValue null_value;
+    const_iterator member = find(key);
+    return member != end() ? member->second : null_value;
+}
+
+/**
+ * Member map of a JsonDocument that keeps the members in insertion order.
+ *
+ * Members live in one dense array, so iteration and serialization follow the
+ * source. Maps with more than detail::kMemberIndexThreshold members also keep
+ * an open-addressing index of positions for constant-time lookup; smaller
+ * ones are scanned. Keys must not be changed through an iterator.
+ *
+ * Keys are views: the map does not own their text. JsonDocument keeps it in
+ * its arena, so a copy of the map is only valid as long as the document.
+ */
+class JsonMemberMap
+{
+public:
+    typedef std::pair<std::string_view, JsonValue> value_type;
+    typedef std::vector<value_type>::iterator iterator;
+    typedef std::vector<value_type>::const_iterator const_iterator;
+
+private:
+    static const size_t kNotFound = static_cast<size_t>(-1);
+
+    std::vector<value_type> _entries;
+    std::vector<uint32_t> _index; // positions + 1, 0 marks a free slot; empty for small maps
+
+    size_t Locate(std::string_view key) const
+    {
+        if (_index.empty())
+        {
+            for (size_t i = 0; i < _entries.size(); ++i)
+            {
+                if (_entries[i].first == key) return i;
+            }
+            return kNotFound;
+        }
+        const size_t mask = _index.size() - 1;
+        for (size_t slot = detail::HashMemberKey(key.data(), key.size()) & mask; _index[slot] != 0; slot = (slot + 1) & mask)
+        {
+            const size_t position = _index[slot] - 1;
+            if (_entries[position].first == key) return position;
+        }
+        return kNotFound;
+    }
+    void Place(size_t position)
+    {
+        const std::string_view key = _entries[position].first;
+        const size_t mask = _index.size() - 1;
+        size_t slot = detail::HashMemberKey(key.data(), key.size()) & mask;
+        while (_index[slot] != 0) slot = (slot + 1) & mask;
+        _index[slot] = static_cast<uint32_t>(position + 1);
+    }
+    void Rehash()
+    {
+        _index.assign(detail::MemberIndexCapacity(static_cast<uint32_t>(_entries.size())), 0);
+        for (size_t i = 0; i < _entries.size(); ++i) Place(i);
+    }
+    // Moves the entries to a larger array. The values stay in the document, so
+    // they keep their payloads instead of being detached by a move.
+    void Grow(size_t capacity)
+    {
+        std::vector<value_type> grown;
+        grown.reserve(capacity);
+        for (value_type& entry : _entries)
+        {
+            grown.emplace_back(entry.first, JsonValue());
+            grown.back().second.RawMoveFrom(entry.second);
+        }
+        _entries.swap(grown);
+    }
+    // value has already been detached where it needed to be.
+    iterator Append(std::string_view key, JsonValue&& value)
+    {
+        if (_entries.size() == _entries.capacity()) Grow(_entries.empty() ? 8 : 2 * _entries.size());
+        _entries.emplace_back(key, JsonValue());
+        _entries.back().second.RawMoveFrom(value);
+        if (_entries.size() > detail::kMemberIndexThreshold)
+        {
+            if (2 * _entries.size() > _index.size()) Rehash();
+            else Place(_entries.size() - 1);
+        }
+        return _entries.end() - 1;
+    }
+
+public:
+    iterator begin() { return _entries.begin(); }
+    iterator end() { return _entries.end(); }
+    const_iterator begin() const { return _entries.begin(); }
+    const_iterator end() const { return _entries.end(); }
+    size_t size() const { return _entries.size(); }
+    bool empty() const { return _entries.empty(); }
+
+    void reserve(size_t count)
+    {
+        if (count > _entries.capacity()) Grow(count);
+    }
+    // Keeps the capacity for the next document.
+    void clear()
+    {
+        _entries.clear();
+        _index.clear();
+    }
+
+    iterator find(std::string_view key)
+    {
+        const size_t position = Locate(key);
+        return position != kNotFound ? _entries.begin() + position : _entries.end();
+    }
+    const_iterator find(std::string_view key) const
+    {
+        const size_t position = Locate(key);
+        return position != kNotFound ? _entries.begin() + position : _entries.end();
+    }
+    size_t count(std::string_view key) const
+    {
+        return Locate(key) != kNotFound ? 1 : 0;
+    }
+    JsonValue& at(std::string_view key)
+    {
+        const size_t position = Locate(key);
+        if (position == kNotFound) throw std::out_of_range("AposaJson: object key not found");
+        return _entries[position].second;
+    }
+    const JsonValue& at(std::string_view key) const
+    {
+        const size_t position = Locate(key);
+        if (position == kNotFound) throw std::out_of_range("AposaJson: object key not found");
+        return _entries[position].second;
+    }
+    // New keys go to the end; an existing key keeps its position. The text of
+    // a new key must outlive the map.
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(std::string_view key, Args&&... args)
+    {
+        const size_t position = Locate(key);
+        if (position != kNotFound) return { _entries.begin() + position, false };
+        return { Append(key, JsonValue(std::forward<Args>(args)...)), true };
+    }
+    template <typename Value>
+    std::pair<iterator, bool> insert_or_assign(std::string_view key, Value&& value)
+    {
+        const size_t position = Locate(key);
+        if (position == kNotFound) return { Append(key, JsonValue(std::forward<Value>(value))), true };
+        _entries[position].second = std::forward<Value>(value);
+        return { _entries.begin() + position, false };
+    }
+};
+
+class JsonDocument
+{
+public:
+#ifdef APOSA_JSON_USE_STDMAP
+    typedef std::map<std::string_view, JsonValue> MemberMap; // sorted by key
+#else
+    typedef JsonMemberMap MemberMap; // in insertion order
+#endif
+    typedef MemberMap::iterator iterator;
+    typedef MemberMap::const_iterator const_iterator;
+
+private:
+    JsonArena _arena; // backs the values created by JsonParser and the member keys; declared first so it dies last
+    MemberMap _map;
+    JsonValue _root; // set instead of the members when the root is not an object
+    bool _has_root;  // the root is _root, which may be null, rather than the members
+
+    friend class JsonDocumentBuilder;
+    friend class JsonSerializer;
+    friend class JsonParallelArrayParser;
+
+    // Member keys are views; their text is copied into the arena once, when
+    // the key is added.
+    std::string_view StoreKey(std::string_view key)
+    {
+        return std::string_view(_arena.CopyString(key.data(), key.size()), key.size());
+    }
+    // The member named key, added as null if missing.
+    JsonValue& Member(std::string_view key)
+    {
+        if (JsonValue* value = Find(key)) return *value;
+        return _map.try_emplace(StoreKey(key)).first->second;
+    }
+    void CopyMembers(const JsonDocument& other)
+    {
+        for (const auto& member : other._map) _map.try_emplace(StoreKey(member.first), member.second);
+    }
+
+public:
+	JsonDocument() :_has_root(false) {}
+    JsonDocument(const JsonDocument& other) :_root(other._root), _has_root(other._has_root)
+    {
+        CopyMembers(other);
+    }
+    // The arena moves along with the values, so the root keeps its payload.
+    JsonDocument(JsonDocument&& other) noexcept
+        :_arena(std::move(other._arena)), _map(std::move(other._map)), _has_root(other._has_root)
+    {
+        _root.RawMoveFrom(other._root);
+    }
+    JsonDocument& operator=(const JsonDocument& other)
+    {
+        if (this != &other)
+        {
+            _map.clear();
+            _root = other._root;
+            _has_root = other._has_root;
+            _arena = JsonArena();
+            CopyMembers(other);
+        }
+        return *this;
+    }
+    JsonDocument& operator=(JsonDocument&& other) noexcept
+    {
+        if (this != &other)
+        {
+            // Drop the old values before the arena they may point into.
+            _map = std::move(other._map);
+            _root.RawAssign(other._root);
+            _has_root = other._has_root;
+            _arena = std::move(other._arena);
+        }
+        return *this;
+    }
+
+	void AddMember(std::string_view key, const JsonValue& value)
+	{
+		Member(key) = value;
+	}
+    void AddMember(std::string_view key, JsonValue&& value)
+    {
+        Member(key) = std::move(value);
+    }
+    // Sets the member key to a value constructed from args, replacing an
+    // existing one, and returns it.
+    template <typename... Args>
+    JsonValue& EmplaceMember(std::string_view key, Args&&... args)
+    {
+        JsonValue& value = Member(key);
+        value = JsonValue(std::forward<Args>(args)...);
+        return value;
+    }
+    // Like EmplaceMember, but leaves an existing member alone and does not
+    // construct a value for it. The flag tells whether a member was added.
+    template <typename... Args>
+    std::pair<JsonValue*, bool> TryEmplaceMember(std::string_view key, Args&&... args)
+    {
+        if (JsonValue* value = Find(key)) return { value, false };
+        auto result = _map.try_emplace(StoreKey(key), std::forward<Args>(args)...);
+        return { &result.first->second, true };
+    }
+    // Removes all members and the root. The arena keeps its memory for the
+    // next document.
+    void Clear()
+    {
+        _map.clear();
+        _root = JsonValue();
+        _has_root = false;
+        _arena.Reset();
+    }
+
+    // The root of a document whose root is an array, string, number, boolean
+    // or null. Null for object roots, whose members are the document members.
+    const JsonValue& GetRoot() const
+    {
+        return _root;
+    }
+
+    const MemberMap& GetMember() const
+    {
+        return _map;
+    }
+
+    iterator begin() { return _map.begin(); }
+    iterator end() { return _map.end(); }
+    const_iterator begin() const { return _map.begin(); }
+    const_iterator end() const { return _map.end(); }
+    size_t Size() const
+    {
+        return _map.size();
+    }
+    bool Empty() const
+    {
+        return _map.empty();
+    }
+    // The member named key, or nullptr. Unlike operator[], a missing key is
+    // not inserted.
+    JsonValue* Find(std::string_view key)
+    {
+        const auto member = _map.find(key);
+        return member != _map.end() ? &member->second : nullptr;
+    }
+    const JsonValue* Find(std::string_view key) const
+    {
+        const auto member = _map.find(key);
+        return member != _map.end() ? &member->second : nullptr;
+    }
+
+	JsonValue& operator[](std::string_view key)
+	{
+        return Member(key);
+	}
+};
+
+/**
+ * SAX handler that accepts every event. Derive from it and hide the events you
+ * need; JsonParser calls them on the derived type without virtual dispatch.
+ *
+ * Strings and keys are passed unescaped, in spans that are only valid during
+ * the call. Numbers are converted once while parsing: integers that fit go to
+ * OnInt64() or OnUint64(), everything else to OnDouble(). Returning false from an event stops the parse
+ * with JsonParseError::Terminated.
+ */
+class JsonHandler
+{
+public:
+    bool OnNull() { return true; }
+    bool OnBool(bool) { return true; }
+    bool OnInt64(int64_t) { return true; }
+    bool OnUint64(uint64_t) { return true; }
+    bool OnDouble(double) { return true; }
+    bool OnString(const char*, size_t) { return true; }
+    bool OnKey(const char*, size_t) { return true; }
+    bool OnStartObject() { return true; }
+    bool OnEndObject(size_t) { return true; }
+    bool OnStartArray() { return true; }
+    bool OnEndArray(size_t) { return true; }
+};
+
+/**
+ * SAX handler that builds a JsonDocument. Values go into the document arena;
+ * the members of an object root become the document members, any other root
+ * becomes the document root.
+ */
+class JsonDocumentBuilder
+{
+private:
+    JsonDocument* _doc;
+    JsonArena* _arena; // the arena of _doc unless the caller supplies one
+    // Finished values of the containers still open; object keys are
+    // interleaved with their values. Keeps its capacity between documents.
+    std::vector<JsonValue> _stack;
+    size_t _depth;
+    // Input the caller keeps alive for the lifetime of the document. Text
+    // inside it is referenced instead of copied.
+    const char* _pinned;
+    size_t _pinned_length;
+
+    // Values on the stack belong to the document being built, so they are
+    // moved with RawMoveFrom() and never detached.
+    JsonValue& Push()
+    {
+        if (_stack.size() == _stack.capacity()) JsonValue::RawReserve(_stack, _stack.empty() ? 64 : 2 * _stack.size());
+        _stack.emplace_back();
+        return _stack.back();
+    }
+    bool IsPinned(const char* str) const
+    {
+        return reinterpret_cast<uintptr_t>(str) - reinterpret_cast<uintptr_t>(_pinned) < _pinned_length;
+    }
+    void PushString(const char* str, size_t length)
+    {
+        if (IsPinned(str)) Push().SetStringView(str, length);
+        else Push().SetString(str, length, *_arena);
+    }
+    bool EndValue()
+    {
+        if (_depth == 0)
+        {
+            _doc->_root.RawAssign(_stack.back());
+            _doc->_has_root = true;
+            _stack.clear();
+        }
+        return true;
+    }
+
+public:
+    JsonDocumentBuilder() :_doc(nullptr), _arena(nullptr), _depth(0), _pinned(nullptr), _pinned_length(0) {}
+    explicit JsonDocumentBuilder(JsonDocument& doc) :_doc(&doc), _arena(&doc._arena), _depth(0), _pinned(nullptr), _pinned_length(0) {}
+
+    void Reset(JsonDocument& doc)
+    {
+        Reset(doc, nullptr, 0);
+    }
+    /**
+     * Builds into doc and lets its strings reference the text in
+     * [pinned, pinned + pinned_length) instead of copying it. That buffer must
+     * outlive doc.
+     */
+    void Reset(JsonDocument& doc, const char* pinned, size_t pinned_length)
+    {
+        _doc = &doc;
+        _arena = &doc._arena;
+        _stack.clear();
+        _depth = 0;
+        _pinned = pinned;
+        _pinned_length = pinned_length;
+    }
+    /**
+     * Builds into doc but carves the values out of arena, so many small
+     * documents can share one arena. Every document built this way is only
+     * valid until arena is reset or destroyed.
+     */
+    void Reset(JsonDocument& doc, JsonArena& arena)
+    {
+        Reset(doc, nullptr, 0);
+        _arena = &arena;
+    }
+
+    bool OnNull()
+    {
+        Push();
+        return EndValue();
+    }
+    bool OnBool(bool value)
+    {
+        Push().SetBoolean(value);
+        return EndValue();
+    }
+    bool OnInt64(int64_t value)
+    {
+        Push().SetInt64(value);
+        return EndValue();
+    }
+    bool OnUint64(uint64_t value)
+    {
+        Push().SetUint64(value);
+        return EndValue();
+    }
+    bool OnDouble(double value)
+    {
+        Push().SetDouble(value);
+        return EndValue();
+    }
+    bool OnString(const char* str, size_t length)
+    {
+        PushString(str, length);
+        return EndValue();
+    }
+    bool OnKey(const char* str, size_t length)
+    {
+        PushString(str, length);
+        return true;
+    }
+    bool OnStartObject()
+    {
+        _depth++;
+        return true;
+    }
+    bool OnEndObject(size_t member_count)
+    {
+        const size_t base = _stack.size() - 2 * member_count;
+        if (--_depth == 0)
+        {
+            for (size_t i = base; i < _stack.size(); i += 2)
+            {
+                // The key text is already in the arena or the pinned input.
+                _doc->_map.try_emplace(_stack[i].GetStringView()).first->second.RawAssign(_stack[i + 1]);
+            }
+            _stack.clear();
+            return true;
+        }
+        JsonValue object;
+        object.SetObject(_stack.data() + base, member_count, *_arena);
+        _stack.erase(_stack.begin() + base, _stack.end());
+        Push().RawMoveFrom(object);
+        return true;
+    }
+    bool OnStartArray()
+    {
+        _depth++;
+        return true;
+    }
+    bool OnEndArray(size_t element_count)
+    {
+        const size_t base = _stack.size() - element_count;
+        JsonValue array;
+        array.SetArray(_stack.data() + base, element_count, *_arena);
+        _stack.erase(_stack.begin() + base, _stack.end());
+        Push().RawMoveFrom(array);
+        --_depth;
+        return EndValue();
+    }
+};
+
+namespace detail
+{
+
+inline int CountTrailingZeros(uint64_t bits)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(bits);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return static_cast<int>(index);
+#else
+    int count = 0;
+    while (!(bits & 1)) { bits >>= 1; count++; }
+    return count;
+#endif
+}
+
+enum class SimdLevel
+{
+    Scalar,
+    Sse42,
+    Avx2
+};
+
+// Picks the widest instruction set supported by the running CPU. The answer is
+// computed once and cached.
+inline SimdLevel DetectSimdLevel()
+{
+#if defined(APOSA_JSON_X86_64) && (defined(__GNUC__) || defined(__clang__))
+    static const SimdLevel level = []()
+    {
+        __builtin_cpu_init();
+        if (!__builtin_cpu_supports("pclmul")) return SimdLevel::Scalar;
+        if (__builtin_cpu_supports("avx2")) return SimdLevel::Avx2;
+        if (__builtin_cpu_supports("sse4.2")) return SimdLevel::Sse42;
+        return SimdLevel::Scalar;
+    }();
+    return level;
+#elif defined(APOSA_JSON_X86_64) && defined(_MSC_VER)
+    static const SimdLevel level = []()
+    {
+        int info[4];
+        __cpuid(info, 1);
+        const bool pclmul = (info[2] & (1 << 1)) != 0;
+        const bool sse42 = (info[2] & (1 << 20)) != 0;
+        const bool os_avx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+        __cpuidex(info, 7, 0);
+        const bool avx2 = os_avx && (info[1] & (1 << 5)) != 0;
+        if (!pclmul) return SimdLevel::Scalar;
+        if (avx2) return SimdLevel::Avx2;
+        if (sse42) return SimdLevel::Sse42;
+        return SimdLevel::Scalar;
+    }();
+    return level;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+// String scanners: return the first quote or backslash in [p, end), or
+// end. With kControl set, control characters stop the scan as well, which
+// finds the bytes a serialized string has to escape.
+template <bool kControl>
+inline const char* ScanStringScalar(const char* p, const char* end)
+{
+    for (; p < end; ++p)
+    {
+        const unsigned char c = static_cast<unsigned char>(*p);
+        if ((kControl && c < 0x20) || c == '\"' || c == '\\') break;
+    }
+    return p;
+}
+#ifdef APOSA_JSON_X86_64
+// SSE2 is part of x86-64, so this needs no runtime check.
+template <bool kControl>
+inline const char* ScanStringSse2(const char* p, const char* end)
+{
+    const __m128i quote = _mm_set1_epi8('\"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1F);
+    for (; end - p >= 16; p += 16)
+    {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash));
+        if (kControl) hits = _mm_or_si128(hits, _mm_cmpeq_epi8(_mm_min_epu8(chunk, control), chunk));
+        const uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(hits));
+        if (mask != 0) return p + CountTrailingZeros(mask);
+    }
+    return ScanStringScalar<kControl>(p, end);
+}
+template <bool kControl>
+APOSA_JSON_TARGET("avx2")
+inline const char* ScanStringAvx2(const char* p, const char* end)
+{
+    const __m256i quote = _mm256_set1_epi8('\"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i control = _mm256_set1_epi8(0x1F);
+    for (; end - p >= 32; p += 32)
+    {
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i hits = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote), _mm256_cmpeq_epi8(chunk, backslash));
+        if (kControl) hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(_mm256_min_epu8(chunk, control), chunk));
+        const uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(hits));
+        if (mask != 0) return p + CountTrailingZeros(mask);
+    }
+    return ScanStringSse2<kControl>(p, end);
+}
+#endif
+template <bool kControl>
+inline const char* ScanString(const char* p, const char* end)
+{
+#ifdef APOSA_JSON_X86_64
+    if (DetectSimdLevel() == SimdLevel::Avx2) return ScanStringAvx2<kControl>(p, end);
+    return ScanStringSse2<kControl>(p, end);
+#else
+    return ScanStringScalar<kControl>(p, end);
+#endif
+}
+inline const char* FindQuoteOrBackslash(const char* p, const char* end)
+{
+    return ScanString<false>(p, end);
+}
+// First byte that must be escaped in a JSON string: a quote, a backslash or a
+// control character.
+inline const char* FindEscape(const char* p, const char* end)
+{
+    return ScanString<true>(p, end);
+}
+
+// Bracket scanners for skipping: return the first quote or bracket in
+// [p, end), or end. OR-ing 0x20 folds '[' onto '{' and ']' onto '}'.
+inline const char* ScanBracketScalar(const char* p, const char* end)
+{
+    for (; p < end; ++p)
+    {
+        const char folded = static_cast<char>(*p | 0x20);
+        if (*p == '\"' || folded == '{' || folded == '}') break;
+    }
+    return p;
+}
+#ifdef APOSA_JSON_X86_64
+inline const char* ScanBracketSse2(const char* p, const char* end)
+{
+    const __m128i quote = _mm_set1_epi8('\"');
+    const __m128i lower_bit = _mm_set1_epi8(0x20);
+    const __m128i open = _mm_set1_epi8('{');
+    const __m128i close = _mm_set1_epi8('}');
+    for (; end - p >= 16; p += 16)
+    {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const __m128i folded = _mm_or_si128(chunk, lower_bit);
+        const __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+            _mm_or_si128(_mm_cmpeq_epi8(folded, open), _mm_cmpeq_epi8(folded, close)));
+        const uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(hits));
+        if (mask != 0) return p + CountTrailingZeros(mask);
+    }
+    return ScanBracketScalar(p, end);
+}
+APOSA_JSON_TARGET("avx2")
+inline const char* ScanBracketAvx2(const char* p, const char* end)
+{
+    const __m256i quote = _mm256_set1_epi8('\"');
+    const __m256i lower_bit = _mm256_set1_epi8(0x20);
+    const __m256i open = _mm256_set1_epi8('{');
+    const __m256i close = _mm256_set1_epi8('}');
+    for (; end - p >= 32; p += 32)
+    {
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        const __m256i folded = _mm256_or_si256(chunk, lower_bit);
+        const __m256i hits = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote),
+            _mm256_or_si256(_mm256_cmpeq_epi8(folded, open), _mm256_cmpeq_epi8(folded, close)));
+        const uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(hits));
+        if (mask != 0) return p + CountTrailingZeros(mask);
+    }
+    return ScanBracketSse2(p, end);
+}
+#endif
+inline const char* FindQuoteOrBracket(const char* p, const char* end)
+{
+#ifdef APOSA_JSON_X86_64
+    if (DetectSimdLevel() == SimdLevel::Avx2) return ScanBracketAvx2(p, end);
+    return ScanBracketSse2(p, end);
+#else
+    return ScanBracketScalar(p, end);
+#endif
+}
+
+// Returns the position after the closing quote of the string whose text
+// starts at p, or nullptr when the input ends first.
+inline const char* SkipString(const char* p, const char* end)
+{
+    for (;; p += 2)
+    {
+        p = FindQuoteOrBackslash(p, end);
+        if (p == end) return nullptr;
+        if (*p == '\"') return p + 1;
+        if (end - p < 2) return nullptr;
+    }
+}
+// Returns the position after the array or object that starts at p, or
+// nullptr when the input ends first. Only quotes and brackets are looked at,
+// so the contents are not validated and mismatched brackets go unnoticed.
+inline const char* SkipContainer(const char* p, const char* end)
+{
+    size_t depth = 0;
+    for (;;)
+    {
+        p = FindQuoteOrBracket(p, end);
+        if (p == end) return nullptr;
+        switch (*p)
+        {
+        case '\"':
+            p = SkipString(p + 1, end);
+            if (p == nullptr) return nullptr;
+            break;
+        case '[':
+        case '{':
+            depth++;
+            p++;
+            break;
+        default:
+            p++;
+            if (--depth == 0) return p;
+            break;
+        }
+    }
+}
+
+/**
+ * Reads the double in [begin, end), which has to be a complete number, with
+ * the same results as std::from_chars: std::errc::result_out_of_range when
+ * it overflows or underflows to zero.
+ */
+inline std::errc ParseDouble(const char* begin, const char* end, double& value)
+{
+#ifndef APOSA_JSON_C_FLOAT_CONVERSION
+    const std::from_chars_result result = std::from_chars(begin, end, value);
+    if (result.ec != std::errc() || result.ptr == end) return result.ec;
+    return std::errc::invalid_argument;
+#else
+    // strtod needs a terminated string and a locale whose decimal point is '.'.
+    char buffer[128];
+    std::string long_text;
+    const size_t length = end - begin;
+    const char* text = buffer;
+    if (length < sizeof(buffer))
+    {
+        std::memcpy(buffer, begin, length);
+        buffer[length] = '\0';
+    }
+    else
+    {
+        long_text.assign(begin, length);
+        text = long_text.c_str();
+    }
+    char* stop = nullptr;
+    errno = 0;
+#if defined(_MSC_VER)
+    static const _locale_t c_locale = _create_locale(LC_NUMERIC, "C");
+    value = _strtod_l(text, &stop, c_locale);
+#elif defined(APOSA_JSON_POSIX)
+    static const locale_t c_locale = newlocale(LC_NUMERIC_MASK, "C", static_cast<locale_t>(0));
+    value = strtod_l(text, &stop, c_locale);
+#else
+    value = std::strtod(text, &stop);
+#endif
+    if (stop != text + length) return std::errc::invalid_argument;
+    if (errno == ERANGE && (value == 0 || std::isinf(value))) return std::errc::result_out_of_range;
+    return std::errc();
+#endif
+}
+
+/**
+ * Writes the shortest text that reads back as value into out, which has room
+ * for 32 characters, and returns its end. value has to be finite.
+ */
+template <typename T>
+inline char* FormatFloating(T value, char* out)
+{
+#ifndef APOSA_JSON_C_FLOAT_CONVERSION
+    return std::to_chars(out, out + 32, value).ptr;
+#else
+    char* end = out;
+    for (int precision = std::numeric_limits<T>::digits10; precision <= std::numeric_limits<T>::max_digits10; ++precision)
+    {
+        end = out + std::snprintf(out, 32, "%.*g", precision, static_cast<double>(value));
+        // The decimal point follows the current locale.
+        for (char* p = out; p < end; ++p)
+        {
+            if (*p != '-' && *p != '+' && *p != 'e' && (*p < '0' || *p > '9')) *p = '.';
+        }
+        double parsed = 0;
+        if (ParseDouble(out, end, parsed) == std::errc() && static_cast<T>(parsed) == value) break;
+    }
+    return end;
+#endif
+}
+
+} // namespace detail
+
+/**
+ * Writers receive the output of JsonSerializer. A writer provides
+ *
+ *     void Put(char c);
+ *     void Write(const char* str, size_t length);
+ *
+ * and can be reused for any number of documents, so serializing into a warm
+ * writer does not allocate.
+ */
+class JsonStringWriter
+{
+private:
+    std::string _buffer;
+
+public:
+    explicit JsonStringWriter(size_t capacity = 0)
+    {
+        _buffer.reserve(capacity);
+    }
+
+    void Put(char c)
+    {
+        _buffer.push_back(c);
+    }
+    void Write(const char* str, size_t length)
+    {
+        _buffer.append(str, length);
+    }
+
+    // Empties the output but keeps the capacity.
+    void Clear()
+    {
+        _buffer.clear();
+    }
+    void Reserve(size_t capacity)
+    {
+        _buffer.reserve(capacity);
+    }
+    const std::string& GetString() const
+    {
+        return _buffer;
+    }
+    std::string& GetString()
+    {
+        return _buffer;
+    }
+};
+
+/**
+ * Writes into a caller-owned buffer of fixed capacity. Output that does not
+ * fit is dropped and HasOverflow() reports it.
+ */
+class JsonBufferWriter
+{
+private:
+    char* _buffer;
+    size_t _capacity;
+    size_t _size;
+    bool _overflow;
+
+public:
+    JsonBufferWriter(char* buffer, size_t capacity) :_buffer(buffer), _capacity(capacity), _size(0), _overflow(false) {}
+
+    void Put(char c)
+    {
+        if (_size < _capacity) _buffer[_size++] = c;
+        else _overflow = true;
+    }
+    void Write(const char* str, size_t length)
+    {
+        if (length > _capacity - _size)
+        {
+            length = _capacity - _size;
+            _overflow = true;
+        }
+        std::memcpy(_buffer + _size, str, length);
+        _size += length;
+    }
+
+    void Clear()
+    {
+        _size = 0;
+        _overflow = false;
+    }
+    size_t GetSize() const
+    {
+        return _size;
+    }
+    bool HasOverflow() const
+    {
+        return _overflow;
+    }
+};
+
+namespace detail
+{
+
+// Collects output in a fixed buffer and hands it to Derived::WriteOut() in
+// large blocks.
+template <typename Derived>
+class BufferedWriter
+{
+private:
+    static const size_t kBufferSize = 16 * 1024;
+
+    char _buffer[kBufferSize];
+    size_t _size;
+    bool _error;
+
+protected:
+    BufferedWriter() :_size(0), _error(false) {}
+
+public:
+    BufferedWriter(const BufferedWriter&) = delete;
+    BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+    void Put(char c)
+    {
+        if (_size == kBufferSize) Flush();
+        _buffer[_size++] = c;
+    }
+    void Write(const char* str, size_t length)
+    {
+        if (length > kBufferSize - _size)
+        {
+            Flush();
+            if (length >= kBufferSize)
+            {
+                if (!static_cast<Derived*>(this)->WriteOut(str, length)) _error = true;
+                return;
+            }
+        }
+        std::memcpy(_buffer + _size, str, length);
+        _size += length;
+    }
+
+    // Passes the buffered output on. Returns false once a write failed.
+    bool Flush()
+    {
+        if (_size != 0 && !static_cast<Derived*>(this)->WriteOut(_buffer, _size)) _error = true;
+        _size = 0;
+        return !_error;
+    }
+    bool HasError() const
+    {
+        return _error;
+    }
+};
+
+} // namespace detail
+
+// Writes to a stdio stream. Output is flushed by Flush() and on destruction.
+class JsonFileWriter : public detail::BufferedWriter<JsonFileWriter>
+{
+private:
+    friend class detail::BufferedWriter<JsonFileWriter>;
+
+    std::FILE* _file;
+
+    bool WriteOut(const char* data, size_t length)
+    {
+        return std::fwrite(data, 1, length, _file) == length;
+    }
+
+public:
+    explicit JsonFileWriter(std::FILE* file) :_file(file) {}
+    ~JsonFileWriter()
+    {
+        Flush();
+    }
+};
+
+#ifdef APOSA_JSON_POSIX
+// Writes to a file descriptor. Output is flushed by Flush() and on destruction.
+class JsonFdWriter : public detail::BufferedWriter<JsonFdWriter>
+{
+private:
+    friend class detail::BufferedWriter<JsonFdWriter>;
+
+    int _fd;
+
+    bool WriteOut(const char* data, size_t length)
+    {
+        while (length != 0)
+        {
+            const ssize_t written = ::write(_fd, data, length);
+            if (written < 0)
+            {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            data += written;
+            length -= written;
+        }
+        return true;
+    }
+
+public:
+    explicit JsonFdWriter(int fd) :_fd(fd) {}
+    ~JsonFdWriter()
+    {
+        Flush();
+    }
+};
+#endif
+
+class JsonSerializer
+{
+private:
+    // Integers are written two digits at a time, back to front.
+    static char* WriteUint64(uint64_t value, char* out)
+    {
+        static const char kDigitPairs[] =
+            "0001020304050607080910111213141516171819202122232425262728293031323334353637383940414243444546474849"
+            "5051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
+        char buffer[20];
+        char* p = buffer + sizeof(buffer);
+        while (value >= 100)
+        {
+            const size_t pair = static_cast<size_t>(value % 100) * 2;
+            value /= 100;
+            *--p = kDigitPairs[pair + 1];
+            *--p = kDigitPairs[pair];
+        }
+        if (value >= 10)
+        {
+            *--p = kDigitPairs[value * 2 + 1];
+            *--p = kDigitPairs[value * 2];
+        }
+        else *--p = static_cast<char>('0' + value);
+        const size_t length = buffer + sizeof(buffer) - p;
+        std::memcpy(out, p, length);
+        return out + length;
+    }
+    static char* WriteInt64(int64_t value, char* out)
+    {
+        uint64_t magnitude = static_cast<uint64_t>(value);
+        if (value < 0)
+        {
+            *out++ = '-';
+            magnitude = 0 - magnitude;
+        }
+        return WriteUint64(magnitude, out);
+    }
+    // Shortest text that reads back as the same value. Integral values keep a
+    // ".0" so they parse back as doubles; NaN and infinities have no JSON form
+    // and are written as null.
+    template <typename T>
+    static char* WriteFloating(T value, char* out)
+    {
+        if (!std::isfinite(value))
+        {
+            std::memcpy(out, "null", 4);
+            return out + 4;
+        }
+        char* end = detail::FormatFloating(value, out);
+        for (const char* p = out; p < end; ++p)
+        {
+            if (*p == '.' || *p == 'e') return end;
+        }
+        *end++ = '.';
+        *end++ = '0';
+        return end;
+    }
+
+    template <typename Writer>
+    void GenNumber(Writer& writer, const JsonValue& value)
+    {
+        char buffer[40];
+        char* end = buffer;
+        switch (value.GetNumberType())
+        {
+        case JsonNumberType::Int:
+            end = WriteInt64(value.GetInt(), buffer);
+            break;
+        case JsonNumberType::Uint:
+            end = WriteUint64(value.GetUint(), buffer);
+            break;
+        case JsonNumberType::Int64:
+            end = WriteInt64(value.GetInt64(), buffer);
+            break;
+        case JsonNumberType::Uint64:
+            end = WriteUint64(value.GetUint64(), buffer);
+            break;
+        case JsonNumberType::Double:
+            end = WriteFloating(value.GetDouble(), buffer);
+            break;
+        case JsonNumberType::Float:
+            end = WriteFloating(value.GetFloat(), buffer);
+            break;
+        case JsonNumberType::Int16:
+            end = WriteInt64(value.GetInt16(), buffer);
+            break;
+        case JsonNumberType::String:
+        {
+            const std::string_view text = value.GetNumberStringView();
+            writer.Write(text.data(), text.size());
+            return;
+        }
+        }
+        writer.Write(buffer, end - buffer);
+    }
+    // Clean runs are found 16 or 32 bytes at a time and copied in one piece.
+    template <typename Writer>
+    void GenString(Writer& writer, const char* str, size_t length)
+    {
+        static const char kHexDigits[] = "0123456789abcdef";
+        const char* end = str + length;
+        writer.Put('\"');
+        for (;;)
+        {
+            const char* special = detail::FindEscape(str, end);
+            if (special != str) writer.Write(str, special - str);
+            if (special == end) break;
+            const unsigned char c = static_cast<unsigned char>(*special);
+            switch (c)
+            {
+            case '\"': writer.Write("\\\"", 2); break;
+            case '\\': writer.Write("\\\\", 2); break;
+            case '\b': writer.Write("\\b", 2); break;
+            case '\f': writer.Write("\\f", 2); break;
+            case '\n': writer.Write("\\n", 2); break;
+            case '\r': writer.Write("\\r", 2); break;
+            case '\t': writer.Write("\\t", 2); break;
+            default:
+            {
+                const char sequence[6] = {'\\', 'u', '0', '0', kHexDigits[c >> 4], kHexDigits[c & 0xF]};
+                writer.Write(sequence, 6);
+                break;
+            }
+            }
+            str = special + 1;
+        }
+        writer.Put('\"');
+    }
+    template <typename Writer>
+    void GenKey(Writer& writer, const char* key, size_t length)
+    {
+        GenString(writer, key, length);
+        writer.Put(':');
+    }
+    template <typename Writer>
+    void GenValue(Writer& writer, const JsonValue& value)
+    {
+        switch (value.GetType())
+        {
+        case JsonValueType::Null:
+            writer.Write("null", 4);
+            break;
+
+        case JsonValueType::Boolean:
+            if (value.GetBoolean()) writer.Write("true", 4);
+            else writer.Write("false", 5);
+            break;
+
+        case JsonValueType::Number:
+            GenNumber(writer, value);
+            break;
+
+        case JsonValueType::String:
+        {
+            const std::string_view str = value.GetStringView();
+            GenString(writer, str.data(), str.size());
+            break;
+        }
+
+        case JsonValueType::Array:
+            GenArray(writer, value);
+            break;
+
+        case JsonValueType::Object:
+            GenObject(writer, value);
+            break;
+        }
+    }
+    template <typename Writer>
+    void GenArray(Writer& writer, const JsonValue& value)
+    {
+        writer.Put('[');
+        bool first = true;
+        for (const JsonValue& item : value.GetArray())
+        {
+            if (!first) writer.Put(',');
+            first = false;
+            GenValue(writer, item);
+        }
+        writer.Put(']');
+    }
+    template <typename Writer>
+    void GenObject(Writer& writer, const JsonValue& obj)
+    {
+        writer.Put('{');
+        bool first = true;
+        for (const JsonMember& member : obj.GetObject())
+        {
+            if (!first) writer.Put(',');
+            first = false;
+            const std::string_view key = member.first.GetStringView();
+            GenKey(writer, key.data(), key.size());
+            GenValue(writer, member.second);
+        }
+        writer.Put('}');
+    }
+
+public:
+    JsonSerializer() {}
+
+    // Writes the members of doc as a JSON object into writer, or its root
+    // when that is not an object.
+    template <typename Writer>
+    void Serialize(const JsonDocument& doc, Writer& writer)
+    {
+        if (doc._has_root)
+        {
+            GenValue(writer, doc._root);
+            return;
+        }
+        writer.Put('{');
+        bool first = true;
+        for (auto const& member : doc)
+        {
+            if (!first) writer.Put(',');
+            first = false;
+            GenKey(writer, member.first.data(), member.first.size());
+            GenValue(writer, member.second);
+        }
+        writer.Put('}');
+    }
+    template <typename Writer>
+    void Serialize(const JsonValue& value, Writer& writer)
+    {
+        GenValue(writer, value);
+    }
+
+    std::string SerializeObject(const JsonDocument& doc)
+    {
+        JsonStringWriter writer;
+        Serialize(doc, writer);
+        return std::move(writer.GetString());
+    }
+};
+namespace detail
+{
+
+/**
+ * Stage 1 of the parser: classifies the input 64 bytes at a time and records
+ * the offset of every structural character ({ } [ ] : ,), every opening quote
+ * and the first byte of every literal or number. Characters inside strings are
+ * never indexed.
+ */
+class JsonStructuralIndexer
+{
+private:
+    uint64_t _prev_escaped;   // first byte of the next block is escaped
+    uint64_t _prev_in_string; // all ones when the previous block ended inside a string
+    uint64_t _prev_scalar;    // previous block ended with a non-quote scalar byte
+
+    // Drops quotes preceded by an odd-length run of backslashes.
+    uint64_t UnescapedQuotes(uint64_t quote, uint64_t backslash)
+    {
+        const uint64_t even_bits = 0x5555555555555555ULL;
+        backslash &= ~_prev_escaped;
+        uint64_t follows_escape = (backslash << 1) | _prev_escaped;
+        uint64_t odd_sequence_starts = backslash & ~even_bits & ~follows_escape;
+        uint64_t sequences_starting_on_even_bits = odd_sequence_starts + backslash;
+        _prev_escaped = sequences_starting_on_even_bits < backslash ? 1 : 0;
+        uint64_t invert_mask = sequences_starting_on_even_bits << 1;
+        uint64_t escaped = (even_bits ^ invert_mask) & follows_escape;
+        return quote & ~escaped;
+    }
+    uint64_t StructuralStarts(uint64_t quote, uint64_t in_string, uint64_t op, uint64_t whitespace)
+    {
+        _prev_in_string = static_cast<uint64_t>(static_cast<int64_t>(in_string) >> 63);
+        uint64_t scalar = ~(op | whitespace);
+        uint64_t nonquote_scalar = scalar & ~quote;
+        uint64_t follows_nonquote_scalar = (nonquote_scalar << 1) | _prev_scalar;
+        _prev_scalar = nonquote_scalar >> 63;
+        uint64_t scalar_starts = scalar & ~follows_nonquote_scalar;
+        // Everything inside a string plus its closing quote.
+        uint64_t string_tail = in_string ^ quote;
+        return (op | scalar_starts) & ~string_tail;
+    }
+    static uint64_t PrefixXor(uint64_t bits)
+    {
+        bits ^= bits << 1;
+        bits ^= bits << 2;
+        bits ^= bits << 4;
+        bits ^= bits << 8;
+        bits ^= bits << 16;
+        bits ^= bits << 32;
+        return bits;
+    }
+    static uint32_t* Flatten(uint32_t* out, uint32_t offset, uint64_t bits)
+    {
+        while (bits)
+        {
+            *out++ = offset + CountTrailingZeros(bits);
+            bits &= bits - 1;
+        }
+        return out;
+    }
+    static const char* Block(const char* json, size_t length, size_t offset, char* padded)
+    {
+        if (length - offset >= 64) return json + offset;
+        std::memset(padded, ' ', 64);
+        std::memcpy(padded, json + offset, length - offset);
+        return padded;
+    }
+
+    uint32_t* IndexScalar(const char* json, size_t length, uint32_t* out, size_t base)
+    {
+        char padded[64];
+        for (size_t offset = 0; offset < length; offset += 64)
+        {
+            const char* block = Block(json, length, offset, padded);
+            uint64_t quote = 0, backslash = 0, op = 0, whitespace = 0;
+            for (int i = 0; i < 64; ++i)
+            {
+                const uint64_t bit = 1ULL << i;
+                switch (block[i])
+                {
+                case '\"': quote |= bit; break;
+                case '\\': backslash |= bit; break;
+                case '{': case '}': case '[': case ']': case ':': case ',': op |= bit; break;
+                case ' ': case '\t': case '\n': case '\r': whitespace |= bit; break;
+                default: break;
+                }
+            }
+            quote = UnescapedQuotes(quote, backslash);
+            uint64_t in_string = PrefixXor(quote) ^ _prev_in_string;
+            out = Flatten(out, static_cast<uint32_t>(base + offset), StructuralStarts(quote, in_string, op, whitespace));
+        }
+        return out;
+    }
+
+#ifdef APOSA_JSON_X86_64
+    APOSA_JSON_TARGET("sse4.2,pclmul")
+    uint32_t* IndexSse42(const char* json, size_t length, uint32_t* out, size_t base)
+    {
+        char padded[64];
+        const __m128i quote_char = _mm_set1_epi8('\"');
+        const __m128i backslash_char = _mm_set1_epi8('\\');
+        const __m128i lower_bit = _mm_set1_epi8(0x20);
+        const __m128i open_char = _mm_set1_epi8('{');  // '[' | 0x20
+        const __m128i close_char = _mm_set1_epi8('}'); // ']' | 0x20
+        const __m128i colon_char = _mm_set1_epi8(':');
+        const __m128i comma_char = _mm_set1_epi8(',');
+        const __m128i space_char = _mm_set1_epi8(' ');
+        const __m128i tab_char = _mm_set1_epi8('\t');
+        const __m128i lf_char = _mm_set1_epi8('\n');
+        const __m128i cr_char = _mm_set1_epi8('\r');
+        const __m128i ones = _mm_set1_epi8(static_cast<char>(0xFF));
+        for (size_t offset = 0; offset < length; offset += 64)
+        {
+            const char* block = Block(json, length, offset, padded);
+            uint64_t quote = 0, backslash = 0, op = 0, whitespace = 0;
+            for (int i = 0; i < 4; ++i)
+            {
+                const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16 * i));
+                const __m128i folded = _mm_or_si128(in, lower_bit);
+                const __m128i ops = _mm_or_si128(
+                    _mm_or_si128(_mm_cmpeq_epi8(folded, open_char), _mm_cmpeq_epi8(folded, close_char)),
+                    _mm_or_si128(_mm_cmpeq_epi8(in, colon_char), _mm_cmpeq_epi8(in, comma_char)));
+                const __m128i spaces = _mm_or_si128(
+                    _mm_or_si128(_mm_cmpeq_epi8(in, space_char), _mm_cmpeq_epi8(in, tab_char)),
+                    _mm_or_si128(_mm_cmpeq_epi8(in, lf_char), _mm_cmpeq_epi8(in, cr_char)));
+                const int shift = 16 * i;
+                quote |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(in, quote_char)))) << shift;
+                backslash |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(in, backslash_char)))) << shift;
+                op |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(ops))) << shift;
+                whitespace |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(spaces))) << shift;
+            }
+            quote = UnescapedQuotes(quote, backslash);
+            uint64_t in_string = static_cast<uint64_t>(_mm_cvtsi128_si64(
+                _mm_clmulepi64_si128(_mm_set_epi64x(0, static_cast<int64_t>(quote)), ones, 0))) ^ _prev_in_string;
+            out = Flatten(out, static_cast<uint32_t>(base + offset), StructuralStarts(quote, in_string, op, whitespace));
+        }
+        return out;
+    }
+
+    APOSA_JSON_TARGET("avx2,pclmul")
+    uint32_t* IndexAvx2(const char* json, size_t length, uint32_t* out, size_t base)
+    {
+        char padded[64];
+        const __m256i quote_char = _mm256_set1_epi8('\"');
+        const __m256i backslash_char = _mm256_set1_epi8('\\');
+        const __m256i lower_bit = _mm256_set1_epi8(0x20);
+        const __m256i open_char = _mm256_set1_epi8('{');  // '[' | 0x20
+        const __m256i close_char = _mm256_set1_epi8('}'); // ']' | 0x20
+        const __m256i colon_char = _mm256_set1_epi8(':');
+        const __m256i comma_char = _mm256_set1_epi8(',');
+        const __m256i space_char = _mm256_set1_epi8(' ');
+        const __m256i tab_char = _mm256_set1_epi8('\t');
+        const __m256i lf_char = _mm256_set1_epi8('\n');
+        const __m256i cr_char = _mm256_set1_epi8('\r');
+        const __m128i ones = _mm_set1_epi8(static_cast<char>(0xFF));
+        for (size_t offset = 0; offset < length; offset += 64)
+        {
+            const char* block = Block(json, length, offset, padded);
+            uint64_t quote = 0, backslash = 0, op = 0, whitespace = 0;
+            for (int i = 0; i < 2; ++i)
+            {
+                const __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32 * i));
+                const __m256i folded = _mm256_or_si256(in, lower_bit);
+                const __m256i ops = _mm256_or_si256(
+                    _mm256_or_si256(_mm256_cmpeq_epi8(folded, open_char), _mm256_cmpeq_epi8(folded, close_char)),
+                    _mm256_or_si256(_mm256_cmpeq_epi8(in, colon_char), _mm256_cmpeq_epi8(in, comma_char)));
+                const __m256i spaces = _mm256_or_si256(
+                    _mm256_or_si256(_mm256_cmpeq_epi8(in, space_char), _mm256_cmpeq_epi8(in, tab_char)),
+                    _mm256_or_si256(_mm256_cmpeq_epi8(in, lf_char), _mm256_cmpeq_epi8(in, cr_char)));
+                const int shift = 32 * i;
+                quote |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(in, quote_char)))) << shift;
+                backslash |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(in, backslash_char)))) << shift;
+                op |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(ops))) << shift;
+                whitespace |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(spaces))) << shift;
+            }
+            quote = UnescapedQuotes(quote, backslash);
+            uint64_t in_string = static_cast<uint64_t>(_mm_cvtsi128_si64(
+                _mm_clmulepi64_si128(_mm_set_epi64x(0, static_cast<int64_t>(quote)), ones, 0))) ^ _prev_in_string;
+            out = Flatten(out, static_cast<uint32_t>(base + offset), StructuralStarts(quote, in_string, op, whitespace));
+        }
+        return out;
+    }
+#endif
+
+public:
+    JsonStructuralIndexer() :_prev_escaped(0), _prev_in_string(0), _prev_scalar(0) {}
+
+    /**
+     * Writes the structural offsets of json into out, which must have room for
+     * length entries, and returns how many were written. unterminated is set
+     * when the input ends inside a string.
+     */
+    size_t Index(const char* json, size_t length, uint32_t* out, bool& unterminated, SimdLevel level = DetectSimdLevel())
+    {
+        _prev_escaped = _prev_in_string = _prev_scalar = 0;
+        const size_t count = IndexWindow(json, length, out, level);
+        unterminated = IsInString();
+        return count;
+    }
+    /**
+     * Resumable form of Index() for input that is indexed a window at a time,
+     * continuing from where the previous call stopped. Every window but the
+     * last must be a multiple of 64 bytes long. Offsets are relative to the
+     * window, plus base.
+     */
+    size_t IndexWindow(const char* json, size_t length, uint32_t* out, SimdLevel level, size_t base = 0)
+    {
+        uint32_t* tail;
+        switch (level)
+        {
+#ifdef APOSA_JSON_X86_64
+        case SimdLevel::Avx2:
+            tail = IndexAvx2(json, length, out, base);
+            break;
+        case SimdLevel::Sse42:
+            tail = IndexSse42(json, length, out, base);
+            break;
+#endif
+        default:
+            tail = IndexScalar(json, length, out, base);
+            break;
+        }
+        return tail - out;
+    }
+    // Whether the input indexed so far ends inside a string.
+    bool IsInString() const
+    {
+        return _prev_in_string != 0;
+    }
+};
+
+/**
+ * Storage for a structural index that is built a window of input at a time.
+ * Room is made for one window of entries before it is indexed, so the buffer
+ * grows with the number of structural characters instead of the input
+ * length. It grows with realloc(), which can remap large blocks instead of
+ * copying them, so the old and the new block are not both resident. Entries
+ * are left uninitialized, and the capacity is kept for reuse.
+ */
+class StructuralBuffer
+{
+private:
+    uint32_t* _entries;
+    size_t _capacity;
+
+public:
+    static const size_t kWindowSize = 1 << 16;
+
+    StructuralBuffer() :_entries(nullptr), _capacity(0) {}
+    StructuralBuffer(const StructuralBuffer&) = delete;
+    StructuralBuffer& operator=(const StructuralBuffer&) = delete;
+    StructuralBuffer(StructuralBuffer&& other) noexcept :_entries(other._entries), _capacity(other._capacity)
+    {
+        other._entries = nullptr;
+        other._capacity = 0;
+    }
+    StructuralBuffer& operator=(StructuralBuffer&& other) noexcept
+    {
+        if (this != &other)
+        {
+            std::free(_entries);
+            _entries = other._entries;
+            _capacity = other._capacity;
+            other._entries = nullptr;
+            other._capacity = 0;
+        }
+        return *this;
+    }
+    ~StructuralBuffer()
+    {
+        std::free(_entries);
+    }
+
+    // Makes room for a window of entries after the first count and returns
+    // where they go.
+    uint32_t* ReserveWindow(size_t count)
+    {
+        if (count + kWindowSize > _capacity)
+        {
+            const size_t capacity = 2 * (count + kWindowSize);
+            void* grown = std::realloc(_entries, capacity * sizeof(uint32_t));
+            if (grown == nullptr) throw std::bad_alloc();
+            _entries = static_cast<uint32_t*>(grown);
+            _capacity = capacity;
+        }
+        return _entries + count;
+    }
+    uint32_t* Data() const
+    {
+        return _entries;
+    }
+};
+
+// A number as the parsers report it: Int64, Uint64 or Double.
+struct ParsedNumber
+{
+    JsonNumberType type;
+    union
+    {
+        int64_t int64_value;
+        uint64_t uint64_value;
+        double double_value;
+    };
+};
+
+template <typename Handler>
+bool ReportNumber(Handler& handler, const ParsedNumber& number)
+{
+    switch (number.type)
+    {
+    case JsonNumberType::Int64:
+        return handler.OnInt64(number.int64_value);
+    case JsonNumberType::Uint64:
+        return handler.OnUint64(number.uint64_value);
+    default:
+        return handler.OnDouble(number.double_value);
+    }
+}
+
+// SWAR digit parsing: checks and converts eight ASCII digits at once.
+inline uint64_t LoadEightDigits(const char* p)
+{
+    uint64_t chunk;
+    std::memcpy(&chunk, p, sizeof(chunk));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    chunk = __builtin_bswap64(chunk);
+#endif
+    return chunk;
+}
+inline bool IsEightDigits(uint64_t chunk)
+{
+    return ((chunk & 0xF0F0F0F0F0F0F0F0) | (((chunk + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) == 0x3333333333333333;
+}
+inline uint32_t ParseEightDigits(uint64_t chunk)
+{
+    const uint64_t mask = 0x000000FF000000FF;
+    chunk -= 0x3030303030303030;
+    chunk = chunk * 10 + (chunk >> 8);
+    chunk = ((chunk & mask) * (100 + (1000000ULL << 32)) + ((chunk >> 16) & mask) * (1 + (10000ULL << 32))) >> 32;
+    return static_cast<uint32_t>(chunk);
+}
+// Appends the digits at p to value, which wraps past 19 digits.
+inline const char* ReadDigits(const char* p, const char* end, uint64_t& value)
+{
+    while (end - p >= 8)
+    {
+        const uint64_t chunk = LoadEightDigits(p);
+        if (!IsEightDigits(chunk)) break;
+        value = value * 100000000 + ParseEightDigits(chunk);
+        p += 8;
+    }
+    for (; p < end && *p >= '0' && *p <= '9'; ++p) value = value * 10 + (*p - '0');
+    return p;
+}
+// Whether an out of range number is too small rather than too large: the
+// decimal exponent of its leading significant digit decides.
+inline bool IsUnderflow(const char* digits, const char* end, int64_t exponent)
+{
+    int64_t leading = exponent - 1;
+    const char* p = digits;
+    if (*p != '0')
+    {
+        for (; p < end && *p >= '0' && *p <= '9'; ++p) ++leading;
+        return leading < 0;
+    }
+    if (++p < end && *p == '.')
+    {
+        for (++p; p < end && *p == '0'; ++p) --leading;
+    }
+    return leading < 0;
+}
+
+/**
+ * Parses the JSON number at the start of [p, end) and returns its end, or
+ * nullptr when the text there is not a valid number or too large for a
+ * double. Integers that fit 64 bits stay exact; everything else becomes the
+ * nearest double, through Clinger's fast path when the digits and the
+ * exponent allow it and ParseDouble otherwise.
+ */
+inline const char* ParseNumber(const char* p, const char* end, ParsedNumber& number)
+{
+    static const double kPowersOfTen[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    const char* begin = p;
+    const bool negative = p < end && *p == '-';
+    if (negative) ++p;
+    const char* digits = p;
+    uint64_t mantissa = 0;
+    if (p < end && *p == '0') ++p;
+    else if (p < end && *p >= '1' && *p <= '9') p = ReadDigits(p, end, mantissa);
+    else return nullptr;
+    size_t digit_count = p - digits;
+    bool integer = true;
+    int64_t exponent = 0;
+    if (p < end && *p == '.')
+    {
+        integer = false;
+        const char* fraction = ++p;
+        p = ReadDigits(p, end, mantissa);
+        if (p == fraction) return nullptr;
+        digit_count += p - fraction;
+        exponent = fraction - p;
+    }
+    int64_t explicit_exponent = 0;
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        integer = false;
+        bool negative_exponent = false;
+        if (++p < end && (*p == '+' || *p == '-')) negative_exponent = *p++ == '-';
+        if (p == end || *p < '0' || *p > '9') return nullptr;
+        for (; p < end && *p >= '0' && *p <= '9'; ++p)
+        {
+            // Saturates far beyond the range of a double.
+            if (explicit_exponent < 100000) explicit_exponent = explicit_exponent * 10 + (*p - '0');
+        }
+        if (negative_exponent) explicit_exponent = -explicit_exponent;
+        exponent += explicit_exponent;
+    }
+
+    if (integer && digit_count <= 19)
+    {
+        if (!negative)
+        {
+            number.type = mantissa <= static_cast<uint64_t>(INT64_MAX) ? JsonNumberType::Int64 : JsonNumberType::Uint64;
+            number.uint64_value = mantissa;
+            return p;
+        }
+        // -0 is kept as a double.
+        if (mantissa != 0 && mantissa <= static_cast<uint64_t>(INT64_MAX) + 1)
+        {
+            number.type = JsonNumberType::Int64;
+            number.int64_value = mantissa == static_cast<uint64_t>(INT64_MAX) + 1 ? INT64_MIN : -static_cast<int64_t>(mantissa);
+            return p;
+        }
+    }
+    if (integer && digit_count == 20 && !negative)
+    {
+        uint64_t value = 0;
+        const char* q = digits;
+        for (; q < p; ++q)
+        {
+            const unsigned digit = *q - '0';
+            if (value > (UINT64_MAX - digit) / 10) break;
+            value = value * 10 + digit;
+        }
+        if (q == p)
+        {
+            number.type = JsonNumberType::Uint64;
+            number.uint64_value = value;
+            return p;
+        }
+    }
+
+    number.type = JsonNumberType::Double;
+#if !defined(FLT_EVAL_METHOD) || FLT_EVAL_METHOD == 0
+    // Both the mantissa and the power of ten are exact doubles, so one
+    // correctly rounded operation gives the correctly rounded result.
+    if (digit_count <= 19 && mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22)
+    {
+        double value = static_cast<double>(mantissa);
+        if (exponent < 0) value /= kPowersOfTen[-exponent];
+        else value *= kPowersOfTen[exponent];
+        number.double_value = negative ? -value : value;
+        return p;
+    }
+#endif
+    double value = 0;
+    const std::errc error = ParseDouble(begin, p, value);
+    if (error == std::errc::result_out_of_range)
+    {
+        if (!IsUnderflow(digits, p, explicit_exponent)) return nullptr;
+        value = negative ? -0.0 : 0.0;
+    }
+    else if (error != std::errc()) return nullptr;
+    number.double_value = value;
+    return p;
+}
+
+// Value of an ASCII hex digit; 16 marks other characters.
+inline uint32_t HexDigit(char c)
+{
+    static const uint8_t kHexDigits[128] = {
+        16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16,
+        16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16,
+        16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16,
+        0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 16, 16, 16, 16, 16, 16,
+        16, 10, 11, 12, 13, 14, 15, 16, 16, 16, 16, 16, 16, 16, 16, 16,
+        16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16,
+        16, 10, 11, 12, 13, 14, 15, 16, 16, 16, 16, 16, 16, 16, 16, 16,
+        16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16
+    };
+    const unsigned char byte = static_cast<unsigned char>(c);
+    return byte < 128 ? kHexDigits[byte] : 16;
+}
+inline bool ReadHex4(const char* p, uint32_t& code)
+{
+    code = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        const uint32_t digit = HexDigit(p[i]);
+        if (digit > 15) return false;
+        code = code << 4 | digit;
+    }
+    return true;
+}
+inline char* EncodeUtf8(uint32_t code, char* out)
+{
+    if (code < 0x80)
+    {
+        *out++ = static_cast<char>(code);
+    }
+    else if (code < 0x800)
+    {
+        *out++ = static_cast<char>(0xC0 | code >> 6);
+        *out++ = static_cast<char>(0x80 | (code & 0x3F));
+    }
+    else if (code < 0x10000)
+    {
+        *out++ = static_cast<char>(0xE0 | code >> 12);
+        *out++ = static_cast<char>(0x80 | (code >> 6 & 0x3F));
+        *out++ = static_cast<char>(0x80 | (code & 0x3F));
+    }
+    else
+    {
+        *out++ = static_cast<char>(0xF0 | code >> 18);
+        *out++ = static_cast<char>(0x80 | (code >> 12 & 0x3F));
+        *out++ = static_cast<char>(0x80 | (code >> 6 & 0x3F));
+        *out++ = static_cast<char>(0x80 | (code & 0x3F));
+    }
+    return out;
+}
+
+// Returns the position after the escape sequence at the backslash p, or
+// nullptr when it is malformed or an unpaired surrogate.
+inline const char* SkipEscape(const char* p, const char* end)
+{
+    if (end - p < 2) return nullptr;
+    switch (p[1])
+    {
+    case '\"': case '\\': case '/': case 'b': case 'f': case 'n': case 'r': case 't':
+        return p + 2;
+    case 'u':
+        break;
+    default:
+        return nullptr;
+    }
+    uint32_t code;
+    if (end - p < 6 || !ReadHex4(p + 2, code) || (code >= 0xDC00 && code <= 0xDFFF)) return nullptr;
+    if (code < 0xD800 || code > 0xDBFF) return p + 6;
+    uint32_t low;
+    if (end - p < 12 || p[6] != '\\' || p[7] != 'u' || !ReadHex4(p + 8, low) || low < 0xDC00 || low > 0xDFFF) return nullptr;
+    return p + 12;
+}
+// Length of the well-formed UTF-8 sequence that starts with the non-ASCII
+// byte at p, or 0 when it is malformed: a stray continuation byte, an
+// overlong form, a surrogate, a code point above U+10FFFF or a truncated
+// sequence.
+inline size_t Utf8SequenceLength(const char* p, const char* end)
+{
+    const unsigned char* s = reinterpret_cast<const unsigned char*>(p);
+    const size_t available = end - p;
+    const unsigned char lead = s[0];
+    unsigned char low = 0x80, high = 0xBF;
+    size_t length;
+    if (lead < 0xC2) return 0;
+    if (lead < 0xE0) length = 2;
+    else if (lead < 0xF0)
+    {
+        length = 3;
+        if (lead == 0xE0) low = 0xA0;
+        if (lead == 0xED) high = 0x9F;
+    }
+    else if (lead < 0xF5)
+    {
+        length = 4;
+        if (lead == 0xF0) low = 0x90;
+        if (lead == 0xF4) high = 0x8F;
+    }
+    else return 0;
+    if (available < length || s[1] < low || s[1] > high) return 0;
+    for (size_t i = 2; i < length; ++i)
+    {
+        if (s[i] < 0x80 || s[i] > 0xBF) return 0;
+    }
+    return length;
+}
+
+/**
+ * UTF-8 validation with the lookup algorithm of Keiser and Lemire
+ * ("Validating UTF-8 In Less Than One Instruction Per Byte"). Each byte and
+ * the byte before it index three 16-entry tables by their nibbles; ANDing the
+ * three entries leaves a bit set for every malformed two-byte pattern. Third
+ * and fourth bytes of longer sequences are checked against the leads two and
+ * three bytes back. Blocks of plain ASCII only check for a sequence cut off
+ * at the end of the previous block.
+ */
+struct Utf8Tables
+{
+    enum : uint8_t
+    {
+        kTooShort = 1 << 0,     // lead not followed by a continuation
+        kTooLong = 1 << 1,      // continuation without a lead
+        kOverlong3 = 1 << 2,
+        kTooLarge = 1 << 3,     // above U+10FFFF
+        kSurrogate = 1 << 4,
+        kOverlong2 = 1 << 5,
+        kTooLarge1000 = 1 << 6,
+        kOverlong4 = 1 << 6,
+        kTwoConts = 1 << 7,     // continuation after a continuation
+        kCarry = kTooShort | kTooLong | kTwoConts
+    };
+    // Indexed by the high nibble of the previous byte.
+    static const uint8_t* Byte1High()
+    {
+        static const uint8_t table[16] = {
+            kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong,
+            kTwoConts, kTwoConts, kTwoConts, kTwoConts,
+            kTooShort | kOverlong2,
+            kTooShort,
+            kTooShort | kOverlong3 | kSurrogate,
+            kTooShort | kTooLarge | kTooLarge1000 | kOverlong4
+        };
+        return table;
+    }
+    // Indexed by the low nibble of the previous byte.
+    static const uint8_t* Byte1Low()
+    {
+        static const uint8_t table[16] = {
+            kCarry | kOverlong3 | kOverlong2 | kOverlong4,
+            kCarry | kOverlong2,
+            kCarry,
+            kCarry,
+            kCarry | kTooLarge,
+            kCarry | kTooLarge | kTooLarge1000,
+            kCarry | kTooLarge | kTooLarge1000,
+            kCarry | kTooLarge | kTooLarge1000,
+            kCarry | kTooLarge | kTooLarge1000,
+            kCarry | kTooLarge | kTooLarge1000,
+            kCarry | kTooLarge | kTooLarge1000,
+            kCarry | kTooLarge | kTooLarge1000,
+            kCarry | kTooLarge | kTooLarge1000,
+            kCarry | kTooLarge | kTooLarge1000 | kSurrogate,
+            kCarry | kTooLarge | kTooLarge1000,
+            kCarry | kTooLarge | kTooLarge1000
+        };
+        return table;
+    }
+    // Indexed by the high nibble of the byte itself.
+    static const uint8_t* Byte2High()
+    {
+        static const uint8_t table[16] = {
+            kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort,
+            kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge1000 | kOverlong4,
+            kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge,
+            kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge,
+            kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge,
+            kTooShort, kTooShort, kTooShort, kTooShort
+        };
+        return table;
+    }
+};
+
+inline const char* FindInvalidUtf8Scalar(const char* p, const char* end)
+{
+    while (p < end)
+    {
+        uint64_t word;
+        if (end - p >= 8 && (std::memcpy(&word, p, 8), (word & 0x8080808080808080ULL) == 0))
+        {
+            p += 8;
+            continue;
+        }
+        if (static_cast<unsigned char>(*p) < 0x80)
+        {
+            ++p;
+            continue;
+        }
+        const size_t length = Utf8SequenceLength(p, end);
+        if (length == 0) return p;
+        p += length;
+    }
+    return end;
+}
+#ifdef APOSA_JSON_X86_64
+// The SIMD validators return end when [p, end) is well-formed, and otherwise
+// the start of the block the first error was flagged in.
+APOSA_JSON_TARGET("sse4.2")
+inline const char* ValidateUtf8Sse42(const char* p, const char* end)
+{
+    const __m128i byte_1_high_table = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Utf8Tables::Byte1High()));
+    const __m128i byte_1_low_table = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Utf8Tables::Byte1Low()));
+    const __m128i byte_2_high_table = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Utf8Tables::Byte2High()));
+    const __m128i low_nibble = _mm_set1_epi8(0x0F);
+    const __m128i third_lead = _mm_set1_epi8(static_cast<char>(0xE0 - 0x80));
+    const __m128i fourth_lead = _mm_set1_epi8(static_cast<char>(0xF0 - 0x80));
+    const __m128i high_bit = _mm_set1_epi8(static_cast<char>(0x80));
+    // A lead in the last three bytes needs more bytes than are left.
+    const __m128i incomplete_max = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        static_cast<char>(0xF0 - 1), static_cast<char>(0xE0 - 1), static_cast<char>(0xC0 - 1));
+    __m128i prev_input = _mm_setzero_si128();
+    __m128i prev_incomplete = _mm_setzero_si128();
+    const char* block = p;
+    char padded[16];
+    for (; block < end; block += 16)
+    {
+        const char* data = block;
+        if (end - block < 16)
+        {
+            // Zeros are ASCII, so a sequence cut off by the end shows up as too short.
+            std::memset(padded, 0, 16);
+            std::memcpy(padded, block, end - block);
+            data = padded;
+        }
+        const __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+        __m128i error = prev_incomplete;
+        prev_incomplete = _mm_setzero_si128();
+        if (_mm_movemask_epi8(input) != 0)
+        {
+            const __m128i prev1 = _mm_alignr_epi8(input, prev_input, 15);
+            const __m128i byte_1_high = _mm_shuffle_epi8(byte_1_high_table, _mm_and_si128(_mm_srli_epi16(prev1, 4), low_nibble));
+            const __m128i byte_1_low = _mm_shuffle_epi8(byte_1_low_table, _mm_and_si128(prev1, low_nibble));
+            const __m128i byte_2_high = _mm_shuffle_epi8(byte_2_high_table, _mm_and_si128(_mm_srli_epi16(input, 4), low_nibble));
+            const __m128i special_cases = _mm_and_si128(_mm_and_si128(byte_1_high, byte_1_low), byte_2_high);
+            const __m128i is_third_byte = _mm_subs_epu8(_mm_alignr_epi8(input, prev_input, 14), third_lead);
+            const __m128i is_fourth_byte = _mm_subs_epu8(_mm_alignr_epi8(input, prev_input, 13), fourth_lead);
+            const __m128i must_be_continuation = _mm_and_si128(_mm_or_si128(is_third_byte, is_fourth_byte), high_bit);
+            error = _mm_xor_si128(must_be_continuation, special_cases);
+            prev_incomplete = _mm_subs_epu8(input, incomplete_max);
+        }
+        if (!_mm_testz_si128(error, error)) return block;
+        prev_input = input;
+    }
+    if (!_mm_testz_si128(prev_incomplete, prev_incomplete)) return block - 16;
+    return end;
+}
+APOSA_JSON_TARGET("avx2")
+inline const char* ValidateUtf8Avx2(const char* p, const char* end)
+{
+    const __m256i byte_1_high_table = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(Utf8Tables::Byte1High())));
+    const __m256i byte_1_low_table = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(Utf8Tables::Byte1Low())));
+    const __m256i byte_2_high_table = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(Utf8Tables::Byte2High())));
+    const __m256i low_nibble = _mm256_set1_epi8(0x0F);
+    const __m256i third_lead = _mm256_set1_epi8(static_cast<char>(0xE0 - 0x80));
+    const __m256i fourth_lead = _mm256_set1_epi8(static_cast<char>(0xF0 - 0x80));
+    const __m256i high_bit = _mm256_set1_epi8(static_cast<char>(0x80));
+    const __m256i incomplete_max = _mm256_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        static_cast<char>(0xF0 - 1), static_cast<char>(0xE0 - 1), static_cast<char>(0xC0 - 1));
+    __m256i prev_input = _mm256_setzero_si256();
+    __m256i prev_incomplete = _mm256_setzero_si256();
+    const char* block = p;
+    char padded[32];
+    for (; block < end; block += 32)
+    {
+        const char* data = block;
+        if (end - block < 32)
+        {
+            std::memset(padded, 0, 32);
+            std::memcpy(padded, block, end - block);
+            data = padded;
+        }
+        const __m256i input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+        __m256i error = prev_incomplete;
+        prev_incomplete = _mm256_setzero_si256();
+        if (_mm256_movemask_epi8(input) != 0)
+        {
+            // The last bytes of the previous block followed by all but the
+            // last bytes of this one, so that alignr can shift across lanes.
+            const __m256i shifted = _mm256_permute2x128_si256(prev_input, input, 0x21);
+            const __m256i prev1 = _mm256_alignr_epi8(input, shifted, 15);
+            const __m256i byte_1_high = _mm256_shuffle_epi8(byte_1_high_table, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), low_nibble));
+            const __m256i byte_1_low = _mm256_shuffle_epi8(byte_1_low_table, _mm256_and_si256(prev1, low_nibble));
+            const __m256i byte_2_high = _mm256_shuffle_epi8(byte_2_high_table, _mm256_and_si256(_mm256_srli_epi16(input, 4), low_nibble));
+            const __m256i special_cases = _mm256_and_si256(_mm256_and_si256(byte_1_high, byte_1_low), byte_2_high);
+            const __m256i is_third_byte = _mm256_subs_epu8(_mm256_alignr_epi8(input, shifted, 14), third_lead);
+            const __m256i is_fourth_byte = _mm256_subs_epu8(_mm256_alignr_epi8(input, shifted, 13), fourth_lead);
+            const __m256i must_be_continuation = _mm256_and_si256(_mm256_or_si256(is_third_byte, is_fourth_byte), high_bit);
+            error = _mm256_xor_si256(must_be_continuation, special_cases);
+            prev_incomplete = _mm256_subs_epu8(input, incomplete_max);
+        }
+        if (!_mm256_testz_si256(error, error)) return block;
+        prev_input = input;
+    }
+    if (!_mm256_testz_si256(prev_incomplete, prev_incomplete)) return block - 32;
+    return end;
+}
+#endif
+// Returns the first byte of [p, end) that starts or continues a malformed
+// UTF-8 sequence, or end when there is none.
+inline const char* FindInvalidUtf8(const char* p, const char* end, SimdLevel level = DetectSimdLevel())
+{
+    const char* block;
+    switch (level)
+    {
+#ifdef APOSA_JSON_X86_64
+    case SimdLevel::Avx2:
+        block = ValidateUtf8Avx2(p, end);
+        break;
+    case SimdLevel::Sse42:
+        block = ValidateUtf8Sse42(p, end);
+        break;
+#endif
+    default:
+        return FindInvalidUtf8Scalar(p, end);
+    }
+    if (block == end) return end;
+    // Errors are flagged at the byte that breaks a sequence, up to three
+    // bytes after its lead. Pinpoint the error with the scalar check, from
+    // the first sequence boundary in the three bytes before the block.
+    const char* q = block - p > 3 ? block - 3 : p;
+    while (q < block && (static_cast<unsigned char>(*q) & 0xC0) == 0x80) ++q;
+    return FindInvalidUtf8Scalar(q, end);
+}
+
+/**
+ * Decodes the escape sequences of the string body [p, end) into out and
+ * returns the end of the decoded text, or nullptr on a malformed escape or an
+ * unpaired surrogate. The output is never longer than the input, so out may
+ * be p itself.
+ */
+inline char* UnescapeString(const char* p, const char* end, char* out)
+{
+    // Decoded byte of each single-character escape; 0 marks invalid escapes.
+    static const char kEscapes[128] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 34, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 47,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 92, 0, 0, 0,
+        0, 0, 8, 0, 0, 0, 12, 0, 0, 0, 0, 0, 0, 0, 10, 0,
+        0, 0, 13, 0, 9, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+    };
+    for (;;)
+    {
+        const char* run = FindQuoteOrBackslash(p, end);
+        if (out != p) std::memmove(out, p, run - p);
+        out += run - p;
+        p = run;
+        if (p == end) return out;
+        if (*p == '\"')
+        {
+            *out++ = *p++;
+            continue;
+        }
+        if (end - p < 2) return nullptr;
+        const unsigned char c = static_cast<unsigned char>(p[1]);
+        p += 2;
+        if (c < 128 && kEscapes[c] != 0)
+        {
+            *out++ = kEscapes[c];
+            continue;
+        }
+        if (c != 'u') return nullptr;
+        uint32_t code;
+        if (end - p < 4 || !ReadHex4(p, code)) return nullptr;
+        p += 4;
+        if (code >= 0xD800 && code <= 0xDBFF)
+        {
+            uint32_t low;
+            if (end - p < 6 || p[0] != '\\' || p[1] != 'u' || !ReadHex4(p + 2, low) || low < 0xDC00 || low > 0xDFFF) return nullptr;
+            p += 6;
+            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+        }
+        else if (code >= 0xDC00 && code <= 0xDFFF) return nullptr;
+        out = EncodeUtf8(code, out);
+    }
+}
+
+/**
+ * Read-only contents of a whole file: mapped into memory where mmap is
+ * available, read into a buffer elsewhere.
+ */
+class MappedFile
+{
+private:
+    const char* _data;
+    size_t _size;
+#ifdef APOSA_JSON_POSIX
+    void* _mapping;
+#else
+    std::string _contents;
+#endif
+
+public:
+#ifdef APOSA_JSON_POSIX
+    MappedFile() :_data(""), _size(0), _mapping(nullptr) {}
+#else
+    MappedFile() :_data(""), _size(0) {}
+#endif
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile()
+    {
+        Close();
+    }
+
+    void Close()
+    {
+#ifdef APOSA_JSON_POSIX
+        if (_mapping != nullptr) ::munmap(_mapping, _size);
+        _mapping = nullptr;
+#else
+        std::string().swap(_contents);
+#endif
+        _data = "";
+        _size = 0;
+    }
+    bool Open(const char* path)
+    {
+        Close();
+#ifdef APOSA_JSON_POSIX
+        const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return false;
+        struct stat info;
+        if (::fstat(fd, &info) != 0 || !S_ISREG(info.st_mode))
+        {
+            ::close(fd);
+            return false;
+        }
+        _size = static_cast<size_t>(info.st_size);
+        if (_size == 0)
+        {
+            ::close(fd);
+            return true;
+        }
+        void* mapping = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED)
+        {
+            _size = 0;
+            return false;
+        }
+#ifdef MADV_SEQUENTIAL
+        // The parser reads front to back once, so read ahead aggressively.
+        ::madvise(mapping, _size, MADV_SEQUENTIAL);
+#endif
+        _mapping = mapping;
+        _data = static_cast<const char*>(mapping);
+        return true;
+#else
+        std::FILE* file = std::fopen(path, "rb");
+        if (file == nullptr) return false;
+        char buffer[64 * 1024];
+        size_t read;
+        while ((read = std::fread(buffer, 1, sizeof(buffer), file)) != 0) _contents.append(buffer, read);
+        const bool failed = std::ferror(file) != 0;
+        std::fclose(file);
+        _data = _contents.data();
+        _size = _contents.size();
+        return !failed;
+#endif
+    }
+
+    const char* GetData() const
+    {
+        return _data;
+    }
+    size_t GetSize() const
+    {
+        return _size;
+    }
+};
+
+} // namespace detail
+
+enum class JsonParseError
+{
+    None,
+    EmptyDocument,
+    RootNotSingular,
+    DocumentTooLarge,
+    DepthExceeded,
+    InvalidValue,
+    InvalidNumber,
+    UnterminatedString,
+    InvalidEscape,
+    MissingName,
+    MissingColon,
+    MissingCommaOrBrace,
+    MissingCommaOrBracket,
+    Terminated,
+    FileError,
+    ControlCharacter, // unescaped inside a string
+    InvalidUtf8
+};
+
+/**
+ * The parts of a document to keep, as a set of JSON Pointers (RFC 6901) such
+ * as "/user/name" or "/items/0". JsonParser::ParseProjected() builds only the
+ * values these point to, plus the objects and arrays on the way to them.
+ * A pointer that is a prefix of another keeps the whole subtree, and ""
+ * keeps everything.
+ */
+class JsonProjection
+{
+private:
+    static const uint32_t kNone = UINT32_MAX;
+
+    struct Child
+    {
+        std::string token;
+        size_t index; // the token as an array index, SIZE_MAX when it is none
+        uint32_t node;
+    };
+    struct Node
+    {
+        std::vector<Child> children;
+        size_t index_end; // one past the largest array index among the children
+        bool keep_all;
+    };
+    // _nodes[0] is the root; the pointers form a tree of their tokens.
+    std::vector<Node> _nodes;
+
+    friend class JsonParser;
+
+    static size_t ToIndex(const std::string& token)
+    {
+        if (token.empty() || token.size() > 19 || (token[0] == '0' && token.size() > 1)) return SIZE_MAX;
+        size_t index = 0;
+        for (char c : token)
+        {
+            if (c < '0' || c > '9') return SIZE_MAX;
+            index = index * 10 + (c - '0');
+        }
+        return index;
+    }
+    bool KeepsAll(uint32_t node) const
+    {
+        return _nodes[node].keep_all;
+    }
+    uint32_t FindMember(uint32_t node, const char* key, size_t length) const
+    {
+        for (const Child& child : _nodes[node].children)
+        {
+            if (child.token.size() == length && std::memcmp(child.token.data(), key, length) == 0) return child.node;
+        }
+        return kNone;
+    }
+    uint32_t FindElement(uint32_t node, size_t index) const
+    {
+        if (index >= _nodes[node].index_end) return kNone;
+        for (const Child& child : _nodes[node].children)
+        {
+            if (child.index == index) return child.node;
+        }
+        return kNone;
+    }
+    size_t GetIndexEnd(uint32_t node) const
+    {
+        return _nodes[node].index_end;
+    }
+
+public:
+    JsonProjection()
+    {
+        Clear();
+    }
+    JsonProjection(std::initializer_list<std::string_view> pointers)
+    {
+        Clear();
+        for (std::string_view pointer : pointers) Add(pointer);
+    }
+
+    /**
+     * Adds pointer to the set. Returns false, leaving the set unchanged, when
+     * it is not a valid JSON Pointer: it has to be empty or start with '/',
+     * and '~' may only appear as "~0" or "~1".
+     */
+    bool Add(std::string_view pointer)
+    {
+        if (!pointer.empty() && pointer[0] != '/') return false;
+        std::vector<std::string> tokens;
+        for (size_t i = 0; i < pointer.size(); ++i)
+        {
+            if (pointer[i] == '/')
+            {
+                tokens.emplace_back();
+                continue;
+            }
+            if (pointer[i] != '~')
+            {
+                tokens.back() += pointer[i];
+                continue;
+            }
+            if (++i == pointer.size() || (pointer[i] != '0' && pointer[i] != '1')) return false;
+            tokens.back() += pointer[i] == '0' ? '~' : '/';
+        }
+
+        uint32_t node = 0;
+        for (const std::string& token : tokens)
+        {
+            if (_nodes[node].keep_all) return true;
+            uint32_t next = FindMember(node, token.data(), token.size());
+            if (next == kNone)
+            {
+                next = static_cast<uint32_t>(_nodes.size());
+                const size_t index = ToIndex(token);
+                if (index != SIZE_MAX && index >= _nodes[node].index_end) _nodes[node].index_end = index + 1;
+                _nodes[node].children.push_back(Child{ token, index, next });
+                _nodes.push_back(Node{ {}, 0, false });
+            }
+            node = next;
+        }
+        _nodes[node].keep_all = true;
+        return true;
+    }
+    // Removes every pointer; nothing but the root container is kept then.
+    void Clear()
+    {
+        _nodes.assign(1, Node{ {}, 0, false });
+    }
+};
+
+class JsonParser
+{
+private:
+    static const uint32_t kMaxDepth = 1024;
+
+    const char* _json;
+    size_t _length;
+    // Stage 1 output: offsets of the structural characters, reused between
+    // calls.
+    detail::StructuralBuffer _structural_buffer;
+    // The index stage 2 walks: _structural_buffer, or one built by the caller.
+    const uint32_t* _structurals;
+    size_t _structural_count;
+    size_t _next;
+    // The last entry opens a string that is never closed.
+    bool _unterminated;
+    JsonParseError _error;
+    size_t _error_offset;
+
+    // Decoded text of the last escaped string, unless parsing in situ.
+    std::vector<char> _unescaped;
+    bool _in_situ;
+    // Set by Validate(): strings are checked strictly and not decoded.
+    bool _validating;
+
+    // Reused for every DOM parse so its stack keeps its capacity.
+    JsonDocumentBuilder _builder;
+
+    bool Fail(JsonParseError error, size_t offset)
+    {
+        _error = error;
+        _error_offset = offset;
+        return false;
+    }
+    // Next structural character, or '\0' once the index is exhausted.
+    char Peek() const
+    {
+        return _next < _structural_count ? _json[_structurals[_next]] : '\0';
+    }
+    size_t PeekOffset() const
+    {
+        return _next < _structural_count ? _structurals[_next] : _length;
+    }
+    bool IsTerminator(size_t offset) const
+    {
+        if (offset >= _length) return true;
+        switch (_json[offset])
+        {
+        case ' ': case '\t': case '\n': case '\r':
+        case ',': case ':': case ']': case '}':
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    bool ParseLiteral(size_t offset, const char* literal, size_t length)
+    {
+        if (_length - offset < length || std::memcmp(_json + offset, literal, length) != 0 || !IsTerminator(offset + length))
+            return Fail(JsonParseError::InvalidValue, offset);
+        return true;
+    }
+    // Strings without escapes are passed on as spans of the input.
+    bool ParseString(size_t offset, const char*& str, size_t& length)
+    {
+        if (_validating) return ValidateString(offset, str, length);
+        const char* begin = _json + offset + 1;
+        const char* end = _json + _length;
+        bool escaped = false;
+        for (const char* p = begin;; p += 2)
+        {
+            p = detail::FindQuoteOrBackslash(p, end);
+            if (p == end) break;
+            if (*p == '\"')
+            {
+                str = begin;
+                length = p - begin;
+                return !escaped || Unescape(offset, str, length);
+            }
+            if (end - p < 2) break;
+            escaped = true;
+        }
+        return Fail(JsonParseError::UnterminatedString, offset);
+    }
+    // Checks escapes and control characters up to the closing quote; UTF-8
+    // has been checked with the index. str and length are set to the raw text.
+    bool ValidateString(size_t offset, const char*& str, size_t& length)
+    {
+        const char* begin = _json + offset + 1;
+        const char* end = _json + _length;
+        const char* p = begin;
+        for (;;)
+        {
+            p = detail::FindEscape(p, end);
+            if (p == end) break;
+            if (*p == '\"')
+            {
+                str = begin;
+                length = p - begin;
+                return true;
+            }
+            if (*p != '\\') return Fail(JsonParseError::ControlCharacter, p - _json);
+            p = detail::SkipEscape(p, end);
+            if (p == nullptr) return Fail(JsonParseError::InvalidEscape, offset);
+        }
+        return Fail(JsonParseError::UnterminatedString, offset);
+    }
+    bool Unescape(size_t offset, const char*& str, size_t& length)
+    {
+        char* out;
+        if (_in_situ)
+        {
+            // The input is ours to overwrite; decoding never grows the text.
+            out = const_cast<char*>(str);
+        }
+        else
+        {
+            if (_unescaped.size() < length) _unescaped.resize(length);
+            out = _unescaped.data();
+        }
+        const char* end = detail::UnescapeString(str, str + length, out);
+        if (end == nullptr) return Fail(JsonParseError::InvalidEscape, offset);
+        str = out;
+        length = end - out;
+        return true;
+    }
+    bool ParseNumber(size_t offset, detail::ParsedNumber& number)
+    {
+        const char* p = detail::ParseNumber(_json + offset, _json + _length, number);
+        if (p == nullptr || !IsTerminator(p - _json)) return Fail(JsonParseError::InvalidNumber, offset);
+        return true;
+    }
+
+    template <typename Handler>
+    bool ParseValue(Handler& handler, uint32_t depth)
+    {
+        if (_next >= _structural_count) return Fail(JsonParseError::InvalidValue, _length);
+        const size_t offset = _structurals[_next++];
+        switch (_json[offset])
+        {
+        case '{':
+            return ParseObject(handler, offset, depth + 1);
+
+        case '[':
+            return ParseArray(handler, offset, depth + 1);
+
+        case '\"':
+        {
+            const char* str;
+            size_t length;
+            if (!ParseString(offset, str, length)) return false;
+            return Emit(handler.OnString(str, length), offset);
+        }
+
+        case 't':
+            if (!ParseLiteral(offset, "true", 4)) return false;
+            return Emit(handler.OnBool(true), offset);
+
+        case 'f':
+            if (!ParseLiteral(offset, "false", 5)) return false;
+            return Emit(handler.OnBool(false), offset);
+
+        case 'n':
+            if (!ParseLiteral(offset, "null", 4)) return false;
+            return Emit(handler.OnNull(), offset);
+
+        case '-':
+        case '0':
+        case '1':
+        case '2':
+        case '3':
+        case '4':
+        case '5':
+        case '6':
+        case '7':
+        case '8':
+        case '9':
+        {
+            detail::ParsedNumber number;
+            if (!ParseNumber(offset, number)) return false;
+            return Emit(detail::ReportNumber(handler, number), offset);
+        }
+
+        default:
+            return Fail(JsonParseError::InvalidValue, offset);
+        }
+    }
+    template <typename Handler>
+    bool ParseArray(Handler& handler, size_t offset, uint32_t depth)
+    {
+        if (depth > kMaxDepth) return Fail(JsonParseError::DepthExceeded, offset);
+        if (!Emit(handler.OnStartArray(), offset)) return false;
+        size_t count = 0;
+        if (Peek() == ']')
+        {
+            return Emit(handler.OnEndArray(count), _structurals[_next++]);
+        }
+        for (;;)
+        {
+            if (!ParseValue(handler, depth)) return false;
+            count++;
+            const char c = Peek();
+            if (c == ',')
+            {
+                _next++;
+                continue;
+            }
+            if (c == ']')
+            {
+                return Emit(handler.OnEndArray(count), _structurals[_next++]);
+            }
+            return Fail(JsonParseError::MissingCommaOrBracket, PeekOffset());
+        }
+    }
+    template <typename Handler>
+    bool ParseObject(Handler& handler, size_t offset, uint32_t depth)
+    {
+        if (depth > kMaxDepth) return Fail(JsonParseError::DepthExceeded, offset);
+        if (!Emit(handler.OnStartObject(), offset)) return false;
+        size_t count = 0;
+        if (Peek() == '}')
+        {
+            return Emit(handler.OnEndObject(count), _structurals[_next++]);
+        }
+        for (;;)
+        {
+            if (Peek() != '\"') return Fail(JsonParseError::MissingName, PeekOffset());
+            const size_t key_offset = _structurals[_next++];
+            const char* key;
+            size_t length;
+            if (!ParseString(key_offset, key, length)) return false;
+            if (!Emit(handler.OnKey(key, length), key_offset)) return false;
+            if (Peek() != ':') return Fail(JsonParseError::MissingColon, PeekOffset());
+            _next++;
+            if (!ParseValue(handler, depth)) return false;
+            count++;
+            const char c = Peek();
+            if (c == ',')
+            {
+                _next++;
+                continue;
+            }
+            if (c == '}')
+            {
+                return Emit(handler.OnEndObject(count), _structurals[_next++]);
+            }
+            return Fail(JsonParseError::MissingCommaOrBrace, PeekOffset());
+        }
+    }
+    // Moves past the value at _next, which Parse would read at depth, without
+    // reporting it. Its structure is checked as Parse checks it: brackets
+    // match, and names, colons and commas are where the grammar puts them,
+    // with the same errors. Strings are neither decoded nor validated, and
+    // numbers and literals are not read beyond their first character.
+    bool SkipValue(uint32_t depth)
+    {
+        // Bit i is set when the container open at level i is an object.
+        uint64_t objects[kMaxDepth / 64 + 1];
+        uint32_t open = 0;
+        for (;;)
+        {
+            if (_next >= _structural_count) return Fail(JsonParseError::InvalidValue, _length);
+            const size_t offset = _structurals[_next++];
+            const char c = _json[offset];
+            if (c == '[' || c == '{')
+            {
+                if (depth + open + 1 > kMaxDepth) return Fail(JsonParseError::DepthExceeded, offset);
+                const bool object = c == '{';
+                if (Peek() != (object ? '}' : ']'))
+                {
+                    const uint64_t bit = uint64_t(1) << (open % 64);
+                    if (object) objects[open / 64] |= bit;
+                    else objects[open / 64] &= ~bit;
+                    open++;
+                    if (object && !SkipName()) return false;
+                    continue;
+                }
+                _next++;
+            }
+            else if (c == '\"')
+            {
+                if (_unterminated && _next == _structural_count) return Fail(JsonParseError::UnterminatedString, offset);
+            }
+            else if (c != 't' && c != 'f' && c != 'n' && c != '-' && (c < '0' || c > '9'))
+            {
+                return Fail(JsonParseError::InvalidValue, offset);
+            }
+            // A value is complete: close the containers it ends and move on to
+            // the next member or element.
+            for (;;)
+            {
+                if (open == 0) return true;
+                const bool object = (objects[(open - 1) / 64] >> ((open - 1) % 64)) & 1;
+                const char next = Peek();
+                if (next == ',')
+                {
+                    _next++;
+                    if (object && !SkipName()) return false;
                     break;
                 }
+                if (next != (object ? '}' : ']'))
+                {
+                    return Fail(object ? JsonParseError::MissingCommaOrBrace : JsonParseError::MissingCommaOrBracket, PeekOffset());
+                }
+                _next++;
+                open--;
+            }
+        }
+    }
+    // Moves past the name and colon in front of a member value being skipped.
+    bool SkipName()
+    {
+        if (Peek() != '\"') return Fail(JsonParseError::MissingName, PeekOffset());
+        const size_t offset = _structurals[_next++];
+        if (_unterminated && _next == _structural_count) return Fail(JsonParseError::UnterminatedString, offset);
+        if (Peek() != ':') return Fail(JsonParseError::MissingColon, PeekOffset());
+        _next++;
+        return true;
+    }
+    // Whether the value at _next is built for node: everything under a kept
+    // pointer, and the containers on the way to one.
+    bool IsProjected(const JsonProjection& projection, uint32_t node) const
+    {
+        if (node == JsonProjection::kNone) return false;
+        const char c = Peek();
+        return projection.KeepsAll(node) || c == '{' || c == '[';
+    }
+    template <typename Handler>
+    bool ParseProjectedValue(Handler& handler, const JsonProjection& projection, uint32_t node, uint32_t depth)
+    {
+        if (projection.KeepsAll(node)) return ParseValue(handler, depth);
+        const size_t offset = _structurals[_next++];
+        if (_json[offset] == '{') return ParseProjectedObject(handler, projection, node, offset, depth + 1);
+        return ParseProjectedArray(handler, projection, node, offset, depth + 1);
+    }
+    template <typename Handler>
+    bool ParseProjectedArray(Handler& handler, const JsonProjection& projection, uint32_t node, size_t offset, uint32_t depth)
+    {
+        if (depth > kMaxDepth) return Fail(JsonParseError::DepthExceeded, offset);
+        if (!Emit(handler.OnStartArray(), offset)) return false;
+        // Skipped elements in front of a kept one become null, so that the
+        // kept ones keep their index.
+        const size_t index_end = projection.GetIndexEnd(node);
+        size_t count = 0;
+        if (Peek() == ']')
+        {
+            return Emit(handler.OnEndArray(count), _structurals[_next++]);
+        }
+        for (size_t index = 0;; ++index)
+        {
+            const size_t element_offset = PeekOffset();
+            const uint32_t child = projection.FindElement(node, index);
+            if (IsProjected(projection, child))
+            {
+                if (!ParseProjectedValue(handler, projection, child, depth)) return false;
+                count++;
+            }
+            else
+            {
+                if (!SkipValue(depth)) return false;
+                if (index + 1 < index_end)
+                {
+                    if (!Emit(handler.OnNull(), element_offset)) return false;
+                    count++;
+                }
+            }
+            const char c = Peek();
+            if (c == ',')
+            {
+                _next++;
+                continue;
+            }
+            if (c == ']')
+            {
+                return Emit(handler.OnEndArray(count), _structurals[_next++]);
+            }
+            return Fail(JsonParseError::MissingCommaOrBracket, PeekOffset());
+        }
+    }
+    template <typename Handler>
+    bool ParseProjectedObject(Handler& handler, const JsonProjection& projection, uint32_t node, size_t offset, uint32_t depth)
+    {
+        if (depth > kMaxDepth) return Fail(JsonParseError::DepthExceeded, offset);
+        if (!Emit(handler.OnStartObject(), offset)) return false;
+        size_t count = 0;
+        if (Peek() == '}')
+        {
+            return Emit(handler.OnEndObject(count), _structurals[_next++]);
+        }
+        for (;;)
+        {
+            if (Peek() != '\"') return Fail(JsonParseError::MissingName, PeekOffset());
+            const size_t key_offset = _structurals[_next++];
+            const char* key;
+            size_t length;
+            if (!ParseString(key_offset, key, length)) return false;
+            if (Peek() != ':') return Fail(JsonParseError::MissingColon, PeekOffset());
+            _next++;
+            const uint32_t child = projection.FindMember(node, key, length);
+            if (IsProjected(projection, child))
+            {
+                if (!Emit(handler.OnKey(key, length), key_offset)) return false;
+                if (!ParseProjectedValue(handler, projection, child, depth)) return false;
+                count++;
+            }
+            else if (!SkipValue(depth)) return false;
+            const char c = Peek();
+            if (c == ',')
+            {
+                _next++;
+                continue;
+            }
+            if (c == '}')
+            {
+                return Emit(handler.OnEndObject(count), _structurals[_next++]);
+            }
+            return Fail(JsonParseError::MissingCommaOrBrace, PeekOffset());
+        }
+    }
+    bool Emit(bool accepted, size_t offset)
+    {
+        return accepted || Fail(JsonParseError::Terminated, offset);
+    }
+
+    // Starts a parse of json: clears the previous error, checks the encoding
+    // and builds the structural index.
+    bool BeginParse(const char* json, size_t length, bool in_situ = false, bool validating = false)
+    {
+        _json = json;
+        _length = length;
+        _error = JsonParseError::None;
+        _error_offset = 0;
+        _in_situ = in_situ;
+        _validating = validating;
+        if (_length > UINT32_MAX) return Fail(JsonParseError::DocumentTooLarge, 0);
+        return CheckUtf8() && BuildIndex();
+    }
+    bool CheckUtf8()
+    {
+        const char* invalid = detail::FindInvalidUtf8(_json, _json + _length);
+        return invalid == _json + _length || Fail(JsonParseError::InvalidUtf8, invalid - _json);
+    }
+    // Indexes the input a window at a time, so the index takes memory for
+    // the structural characters only rather than an entry per input byte.
+    bool BuildIndex()
+    {
+        const size_t window_size = detail::StructuralBuffer::kWindowSize;
+        detail::JsonStructuralIndexer indexer;
+        const detail::SimdLevel level = detail::DetectSimdLevel();
+        size_t count = 0;
+        for (size_t window = 0; window < _length; window += window_size)
+        {
+            const size_t size = _length - window < window_size ? _length - window : window_size;
+            uint32_t* offsets = _structural_buffer.ReserveWindow(count);
+            count += indexer.IndexWindow(_json + window, size, offsets, level, window);
+        }
+        // An unterminated string leaves its opening quote as the last entry.
+        // Stage 2 reports it there, after any error in front of it, which
+        // gives the code and offset JsonPushParser reports.
+        _unterminated = indexer.IsInString();
+        _structurals = _structural_buffer.Data();
+        _structural_count = count;
+        _next = 0;
+        if (_structural_count == 0) return Fail(JsonParseError::EmptyDocument, 0);
+        return true;
+    }
+    // Stage 2: walks the structural index and reports every value to handler.
+    template <typename Handler>
+    bool ParseDocument(Handler& handler)
+    {
+        if (!ParseValue(handler, 0)) return false;
+        if (_next != _structural_count) return Fail(JsonParseError::RootNotSingular, PeekOffset());
+        return true;
+    }
+    /**
+     * Parses a run of comma-separated elements cut out of a root array, as
+     * JsonParallelArrayParser hands them out, and reports them to handler as
+     * one array of count elements. structurals is the index of json, which
+     * the caller has already built and which must not end inside a string.
+     * Depths and errors are the ones a parse of the whole array gives; error
+     * offsets are relative to json.
+     */
+    template <typename Handler>
+    bool ParseElements(const char* json, size_t length, const uint32_t* structurals, size_t structural_count, Handler& handler, size_t& count)
+    {
+        count = 0;
+        _json = json;
+        _length = length;
+        _error = JsonParseError::None;
+        _error_offset = 0;
+        _in_situ = false;
+        _validating = false;
+        if (!CheckUtf8()) return false;
+        _structurals = structurals;
+        _structural_count = structural_count;
+        _next = 0;
+        _unterminated = false;
+        if (!Emit(handler.OnStartArray(), 0)) return false;
+        for (;;)
+        {
+            if (!ParseValue(handler, 1)) return false;
+            count++;
+            if (_next == _structural_count) break;
+            if (Peek() != ',') return Fail(JsonParseError::MissingCommaOrBracket, PeekOffset());
+            _next++;
+        }
+        return Emit(handler.OnEndArray(count), _length);
+    }
+
+    friend class JsonParallelArrayParser;
+
+public:
+    JsonParser()
+        :_json(nullptr), _length(0), _structurals(nullptr), _structural_count(0), _next(0), _unterminated(false), _error(JsonParseError::None), _error_offset(0), _in_situ(false), _validating(false) {}
+
+    JsonDocument Parse(const std::string& json_str)
+    {
+        return Parse(json_str.data(), json_str.size());
+    }
+    /**
+     * Parses json in two stages: a SIMD pass that indexes the structural
+     * characters, then a pass over that index that builds the document. Input
+     * that is not valid UTF-8 is rejected up front with a SIMD check. On
+     * malformed input an empty document is returned and GetParseError() tells
+     * what went wrong.
+     */
+    JsonDocument Parse(const char* json, size_t length)
+    {
+        JsonDocument doc;
+        _builder.Reset(doc);
+        if (!Parse(json, length, _builder)) return JsonDocument();
+        return doc;
+    }
+    /**
+     * Like Parse(), but strings without escapes are not copied: the values
+     * point into json, which has to outlive the document and stay
+     * unchanged. Escaped strings are decoded into the document arena.
+     */
+    JsonDocument ParseZeroCopy(const char* json, size_t length)
+    {
+        JsonDocument doc;
+        _builder.Reset(doc, json, length);
+        if (!Parse(json, length, _builder)) return JsonDocument();
+        return doc;
+    }
+    /**
+     * Parses buf destructively: escaped strings are decoded in place, so the
+     * document references buf for all of its strings and copies none of
+     * them. buf has to outlive the document; its contents are
+     * unspecified afterwards, even on error.
+     */
+    JsonDocument ParseInSitu(char* buf, size_t length)
+    {
+        JsonDocument doc;
+        _builder.Reset(doc, buf, length);
+        if (!ParseInSitu(buf, length, _builder)) return JsonDocument();
+        return doc;
+    }
+
+    template <typename Handler>
+    bool Parse(const std::string& json_str, Handler& handler)
+    {
+        return Parse(json_str.data(), json_str.size(), handler);
+    }
+    /**
+     * Parses json and reports it to a SAX handler (see JsonHandler) instead of
+     * building a document. Nothing is allocated besides the structural index.
+     * Returns false on malformed input or when the handler stops the parse.
+     */
+    template <typename Handler>
+    bool Parse(const char* json, size_t length, Handler& handler)
+    {
+        return BeginParse(json, length) && ParseDocument(handler);
+    }
+    /**
+     * Parses the file at path without reading it into a string first: the
+     * file is memory-mapped and parsed straight from the mapping. No padding
+     * is needed, as the parser never reads past the end of its input. Fails
+     * with JsonParseError::FileError when the file cannot be opened or mapped.
+     */
+    JsonDocument ParseFile(const char* path)
+    {
+        JsonDocument doc;
+        _builder.Reset(doc);
+        if (!ParseFile(path, _builder)) return JsonDocument();
+        return doc;
+    }
+    template <typename Handler>
+    bool ParseFile(const char* path, Handler& handler)
+    {
+        detail::MappedFile file;
+        if (!file.Open(path))
+        {
+            _length = 0;
+            return Fail(JsonParseError::FileError, 0);
+        }
+        return Parse(file.GetData(), file.GetSize(), handler);
+    }
+
+    /**
+     * Like Parse(), but only the parts of json that projection selects are
+     * built. Everything else is skipped over the structural index: its
+     * strings are not decoded and its numbers not converted, but its
+     * structure is checked, so malformed brackets, names or commas fail as
+     * they do in Parse(). The contents of skipped strings, numbers and
+     * literals are not; Validate() checks those. A root that is neither an
+     * object nor an array is always kept.
+     */
+    JsonDocument ParseProjected(const char* json, size_t length, const JsonProjection& projection)
+    {
+        JsonDocument doc;
+        _builder.Reset(doc);
+        if (!ParseProjected(json, length, projection, _builder)) return JsonDocument();
+        return doc;
+    }
+    // SAX form of ParseProjected(): only the selected values are reported.
+    template <typename Handler>
+    bool ParseProjected(const char* json, size_t length, const JsonProjection& projection, Handler& handler)
+    {
+        if (!BeginParse(json, length)) return false;
+        if (!IsProjected(projection, 0)) return ParseDocument(handler);
+        if (!ParseProjectedValue(handler, projection, 0, 0)) return false;
+        if (_next != _structural_count) return Fail(JsonParseError::RootNotSingular, PeekOffset());
+        return true;
+    }
+
+    /**
+     * Checks that json is well-formed as RFC 8259 defines it, without
+     * building anything. Beyond the grammar, strings may contain neither
+     * unescaped control characters nor invalid UTF-8. Nothing is allocated
+     * besides the structural index, which keeps its capacity between calls.
+     * On failure GetParseError() and GetErrorOffset() tell what and where.
+     */
+    bool Validate(const char* json, size_t length)
+    {
+        JsonHandler handler;
+        return BeginParse(json, length, false, true) && ParseDocument(handler);
+    }
+    bool Validate(const std::string& json_str)
+    {
+        return Validate(json_str.data(), json_str.size());
+    }
+
+    // SAX form of ParseInSitu(): the handler gets spans of buf.
+    template <typename Handler>
+    bool ParseInSitu(char* buf, size_t length, Handler& handler)
+    {
+        return BeginParse(buf, length, true) && ParseDocument(handler);
+    }
+
+    bool HasParseError() const
+    {
+        return _error != JsonParseError::None;
+    }
+    JsonParseError GetParseError() const
+    {
+        return _error;
+    }
+    // Byte offset in the input where the error was detected.
+    size_t GetErrorOffset() const
+    {
+        return _error_offset;
+    }
+};
+
+/**
+ * Resumable parser for input that arrives in pieces, e.g. from a socket.
+ * Feed() takes the chunks as they come and reports every value to the handler
+ * as soon as it is complete; Finish() marks the end of the input. The events
+ * are the ones JsonParser reports, so a JsonDocumentBuilder builds the same
+ * document. Only strings and numbers that straddle two chunks are copied, into
+ * a buffer that keeps its capacity. Each chunk is checked for UTF-8 before it
+ * is parsed; a multi-byte sequence may be split across chunks.
+ */
+template <typename Handler>
+class JsonPushParser
+{
+private:
+    static const size_t kMaxDepth = 1024;
+
+    enum class State : uint8_t
+    {
+        Start,      // before the root value
+        Value,      // after ':', or after ',' in an array
+        ValueOrEnd, // after '['
+        Key,        // after ',' in an object
+        KeyOrEnd,   // after '{'
+        Colon,      // after a key
+        CommaOrEnd, // after a value in a container
+        Done,       // after the root value
+        String,
+        Number,
+        Literal
+    };
+    struct Level
+    {
+        bool object;
+        size_t count;
+    };
+
+    Handler* _handler;
+    State _state;
+    // The containers still open, innermost last.
+    std::vector<Level> _levels;
+
+    // The token being read. _token holds its bytes from earlier chunks once
+    // _carried is set.
+    std::string _token;
+    bool _carried;
+    bool _key;
+    bool _has_escapes;
+    // The previous chunk ended in the middle of an escape sequence.
+    bool _escaped;
+    const char* _literal;
+    size_t _literal_length;
+    size_t _literal_matched;
+    size_t _token_offset;
+
+    // The chunk being fed and the number of bytes fed before it.
+    const char* _chunk;
+    size_t _offset;
+    // The start of a UTF-8 sequence that the previous chunk cut off; it is
+    // not parsed, nor counted in _offset, until it is complete.
+    char _utf8_tail[4];
+    size_t _utf8_tail_length;
+    JsonParseError _error;
+    size_t _error_offset;
+
+    bool Fail(JsonParseError error, size_t offset)
+    {
+        _error = error;
+        _error_offset = offset;
+        return false;
+    }
+    bool Emit(bool accepted, size_t offset)
+    {
+        return accepted || Fail(JsonParseError::Terminated, offset);
+    }
+    size_t Offset(const char* p) const
+    {
+        return _offset + (p - _chunk);
+    }
+    static bool IsWhitespace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+    // Number of bytes at the end of [p, end) that start a UTF-8 sequence
+    // running past end; 0 when the last sequence is whole.
+    static size_t IncompleteUtf8Length(const char* p, const char* end)
+    {
+        for (size_t back = 1; back <= 3 && back <= static_cast<size_t>(end - p); ++back)
+        {
+            const unsigned char c = static_cast<unsigned char>(*(end - back));
+            if ((c & 0xC0) == 0x80) continue;
+            const size_t length = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : c >= 0xC0 ? 2 : 1;
+            return length > back ? back : 0;
+        }
+        return 0;
+    }
+    // Parses the bytes of a chunk that are known to be well-formed UTF-8.
+    bool ParseChunk(const char* data, size_t length)
+    {
+        _chunk = data;
+        const char* p = data;
+        const char* end = data + length;
+        while (p < end)
+        {
+            switch (_state)
+            {
+            case State::String:
+                if (!ReadString(p, end)) return false;
+                continue;
+            case State::Number:
+                if (!ReadNumber(p, end)) return false;
+                continue;
+            case State::Literal:
+                if (!ReadLiteral(p, end)) return false;
+                continue;
+            default:
                 break;
+            }
+            if (IsWhitespace(*p))
+            {
+                ++p;
+                continue;
+            }
+            if (!ReadStructural(*p, Offset(p))) return false;
+            // Numbers are read from their first character on.
+            if (_state != State::Number) ++p;
+        }
+        _offset += length;
+        return true;
+    }
+    static bool IsTerminator(char c)
+    {
+        return IsWhitespace(c) || c == ',' || c == ':' || c == ']' || c == '}';
+    }
+    static bool IsNumberChar(char c)
+    {
+        return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+    }
+
+    void BeginToken(State state, size_t offset)
+    {
+        _state = state;
+        _carried = false;
+        _token_offset = offset;
+    }
+    // Tokens are limited to 4 GiB, like the documents of JsonParser.
+    bool Carry(const char* begin, const char* end)
+    {
+        if (!_carried)
+        {
+            _token.clear();
+            _carried = true;
+        }
+        if (static_cast<size_t>(end - begin) > UINT32_MAX - _token.size()) return Fail(JsonParseError::DocumentTooLarge, _token_offset);
+        _token.append(begin, end - begin);
+        return true;
+    }
+    void EndValue()
+    {
+        if (_levels.empty())
+        {
+            _state = State::Done;
+            return;
+        }
+        _levels.back().count++;
+        _state = State::CommaOrEnd;
+    }
+
+    bool StartValue(char c, size_t offset)
+    {
+        switch (c)
+        {
+        case '{':
+        case '[':
+        {
+            if (_levels.size() >= kMaxDepth) return Fail(JsonParseError::DepthExceeded, offset);
+            const bool object = c == '{';
+            _levels.push_back(Level{object, 0});
+            _state = object ? State::KeyOrEnd : State::ValueOrEnd;
+            return Emit(object ? _handler->OnStartObject() : _handler->OnStartArray(), offset);
+        }
+
+        case '\"':
+            BeginToken(State::String, offset);
+            _key = false;
+            _has_escapes = false;
+            return true;
+
+        case 't':
+            return StartLiteral("true", 4, offset);
+
+        case 'f':
+            return StartLiteral("false", 5, offset);
+
+        case 'n':
+            return StartLiteral("null", 4, offset);
+
+        case '-':
+        case '0':
+        case '1':
+        case '2':
+        case '3':
+        case '4':
+        case '5':
+        case '6':
+        case '7':
+        case '8':
+        case '9':
+            BeginToken(State::Number, offset);
+            return true;
+
+        default:
+            return Fail(JsonParseError::InvalidValue, offset);
+        }
+    }
+    bool StartLiteral(const char* literal, size_t length, size_t offset)
+    {
+        BeginToken(State::Literal, offset);
+        _literal = literal;
+        _literal_length = length;
+        _literal_matched = 1;
+        return true;
+    }
+    bool EndContainer(size_t offset)
+    {
+        const Level level = _levels.back();
+        _levels.pop_back();
+        if (!Emit(level.object ? _handler->OnEndObject(level.count) : _handler->OnEndArray(level.count), offset)) return false;
+        EndValue();
+        return true;
+    }
+    bool ReadStructural(char c, size_t offset)
+    {
+        switch (_state)
+        {
+        case State::Start:
+        case State::Value:
+            return StartValue(c, offset);
+
+        case State::ValueOrEnd:
+            if (c == ']') return EndContainer(offset);
+            return StartValue(c, offset);
+
+        case State::KeyOrEnd:
+            if (c == '}') return EndContainer(offset);
+            // fall through
+        case State::Key:
+            if (c != '\"') return Fail(JsonParseError::MissingName, offset);
+            BeginToken(State::String, offset);
+            _key = true;
+            _has_escapes = false;
+            return true;
+
+        case State::Colon:
+            if (c != ':') return Fail(JsonParseError::MissingColon, offset);
+            _state = State::Value;
+            return true;
+
+        case State::CommaOrEnd:
+        {
+            const bool object = _levels.back().object;
+            if (c == ',')
+            {
+                _state = object ? State::Key : State::Value;
+                return true;
+            }
+            if (c == (object ? '}' : ']')) return EndContainer(offset);
+            return Fail(object ? JsonParseError::MissingCommaOrBrace : JsonParseError::MissingCommaOrBracket, offset);
+        }
+
+        default:
+            return Fail(JsonParseError::RootNotSingular, offset);
+        }
+    }
+
+    bool ReadString(const char*& p, const char* end)
+    {
+        const char* begin = p;
+        if (_escaped)
+        {
+            _escaped = false;
+            ++p;
+        }
+        for (;;)
+        {
+            p = detail::FindQuoteOrBackslash(p, end);
+            if (p < end && *p == '\"') break;
+            if (p < end)
+            {
+                _has_escapes = true;
+                if (++p == end) _escaped = true;
+            }
+            if (p == end) return Carry(begin, p);
+            ++p;
+        }
+        const char* str = begin;
+        size_t length = p - begin;
+        if (length > UINT32_MAX - (_carried ? _token.size() : 0)) return Fail(JsonParseError::DocumentTooLarge, _token_offset);
+        if (_carried || _has_escapes)
+        {
+            if (_carried) _token.append(begin, length);
+            else _token.assign(begin, length);
+            char* text = &_token[0];
+            const char* text_end = detail::UnescapeString(text, text + _token.size(), text);
+            if (text_end == nullptr) return Fail(JsonParseError::InvalidEscape, _token_offset);
+            str = text;
+            length = text_end - text;
+        }
+        ++p;
+        if (_key)
+        {
+            _state = State::Colon;
+            return Emit(_handler->OnKey(str, length), _token_offset);
+        }
+        if (!Emit(_handler->OnString(str, length), _token_offset)) return false;
+        EndValue();
+        return true;
+    }
+    bool ReadNumber(const char*& p, const char* end)
+    {
+        const char* begin = p;
+        while (p < end && IsNumberChar(*p)) ++p;
+        if (p == end) return Carry(begin, p);
+        if (!IsTerminator(*p)) return Fail(JsonParseError::InvalidNumber, _token_offset);
+        return EndNumber(begin, p);
+    }
+    bool EndNumber(const char* begin, const char* end)
+    {
+        const char* str = begin;
+        size_t length = end - begin;
+        if (_carried)
+        {
+            if (length != 0) _token.append(begin, length);
+            str = _token.data();
+            length = _token.size();
+        }
+        detail::ParsedNumber number;
+        if (detail::ParseNumber(str, str + length, number) != str + length) return Fail(JsonParseError::InvalidNumber, _token_offset);
+        if (!Emit(detail::ReportNumber(*_handler, number), _token_offset)) return false;
+        EndValue();
+        return true;
+    }
+    bool ReadLiteral(const char*& p, const char* end)
+    {
+        for (; p < end && _literal_matched < _literal_length; ++p, ++_literal_matched)
+        {
+            if (*p != _literal[_literal_matched]) return Fail(JsonParseError::InvalidValue, _token_offset);
+        }
+        if (p == end) return true;
+        if (!IsTerminator(*p)) return Fail(JsonParseError::InvalidValue, _token_offset);
+        return EndLiteral();
+    }
+    bool EndLiteral()
+    {
+        bool accepted;
+        switch (_literal[0])
+        {
+        case 't': accepted = _handler->OnBool(true); break;
+        case 'f': accepted = _handler->OnBool(false); break;
+        default: accepted = _handler->OnNull(); break;
+        }
+        if (!Emit(accepted, _token_offset)) return false;
+        EndValue();
+        return true;
+    }
+
+public:
+    explicit JsonPushParser(Handler& handler)
+        :_handler(&handler), _state(State::Start), _carried(false), _key(false), _has_escapes(false), _escaped(false), _literal(nullptr),
+        _literal_length(0), _literal_matched(0), _token_offset(0), _chunk(nullptr), _offset(0), _utf8_tail_length(0), _error(JsonParseError::None), _error_offset(0) {}
+
+    // Starts over with a new document, keeping the buffers.
+    void Reset()
+    {
+        _state = State::Start;
+        _levels.clear();
+        _carried = _escaped = false;
+        _offset = 0;
+        _utf8_tail_length = 0;
+        _error = JsonParseError::None;
+        _error_offset = 0;
+    }
+    void Reset(Handler& handler)
+    {
+        _handler = &handler;
+        Reset();
+    }
+
+    /**
+     * Parses the next length bytes of the document. A chunk may end anywhere,
+     * including inside a token. Returns false once the input is known to be
+     * malformed or the handler stopped the parse; later calls then fail too.
+     */
+    bool Feed(const char* data, size_t length)
+    {
+        if (_error != JsonParseError::None) return false;
+        // Every byte is checked for UTF-8 before it is parsed. A sequence cut
+        // off at the end of a chunk is held back until the next chunk
+        // completes it, and parsed on its own then.
+        const char* p = data;
+        const char* end = data + length;
+        char sequence[4];
+        size_t sequence_length = 0;
+        if (_utf8_tail_length != 0)
+        {
+            const unsigned char lead = static_cast<unsigned char>(_utf8_tail[0]);
+            const size_t needed = lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : 2;
+            std::memcpy(sequence, _utf8_tail, _utf8_tail_length);
+            sequence_length = _utf8_tail_length;
+            while (sequence_length < needed && p < end) sequence[sequence_length++] = *p++;
+            if (sequence_length < needed)
+            {
+                for (size_t i = _utf8_tail_length; i < sequence_length; ++i)
+                {
+                    if ((static_cast<unsigned char>(sequence[i]) & 0xC0) != 0x80) return Fail(JsonParseError::InvalidUtf8, _offset);
+                }
+                std::memcpy(_utf8_tail, sequence, sequence_length);
+                _utf8_tail_length = sequence_length;
+                return true;
+            }
+            if (detail::Utf8SequenceLength(sequence, sequence + sequence_length) != needed) return Fail(JsonParseError::InvalidUtf8, _offset);
+        }
+        const size_t incomplete = IncompleteUtf8Length(p, end);
+        const char* invalid = detail::FindInvalidUtf8(p, end - incomplete);
+        if (invalid != end - incomplete) return Fail(JsonParseError::InvalidUtf8, _offset + sequence_length + (invalid - p));
+        if (sequence_length != 0 && !ParseChunk(sequence, sequence_length)) return false;
+        if (!ParseChunk(p, end - incomplete - p)) return false;
+        std::memcpy(_utf8_tail, end - incomplete, incomplete);
+        _utf8_tail_length = incomplete;
+        return true;
+    }
+    // Ends the input: completes a trailing number or literal and checks that
+    // the document is whole.
+    bool Finish()
+    {
+        if (_error != JsonParseError::None) return false;
+        if (_utf8_tail_length != 0) return Fail(JsonParseError::InvalidUtf8, _offset);
+        switch (_state)
+        {
+        case State::String:
+            return Fail(JsonParseError::UnterminatedString, _token_offset);
+        case State::Number:
+            if (!EndNumber(nullptr, nullptr)) return false;
+            break;
+        case State::Literal:
+            if (_literal_matched < _literal_length) return Fail(JsonParseError::InvalidValue, _token_offset);
+            if (!EndLiteral()) return false;
+            break;
+        default:
+            break;
+        }
+        switch (_state)
+        {
+        case State::Done:
+            return true;
+        case State::Start:
+            return Fail(JsonParseError::EmptyDocument, 0);
+        case State::Key:
+        case State::KeyOrEnd:
+            return Fail(JsonParseError::MissingName, _offset);
+        case State::Colon:
+            return Fail(JsonParseError::MissingColon, _offset);
+        case State::CommaOrEnd:
+            return Fail(_levels.back().object ? JsonParseError::MissingCommaOrBrace : JsonParseError::MissingCommaOrBracket, _offset);
+        default:
+            return Fail(JsonParseError::InvalidValue, _offset);
+        }
+    }
+
+    bool HasParseError() const
+    {
+        return _error != JsonParseError::None;
+    }
+    JsonParseError GetParseError() const
+    {
+        return _error;
+    }
+    // Byte offset from the start of the document where the error was detected.
+    size_t GetErrorOffset() const
+    {
+        return _error_offset;
+    }
+};
+
+/**
+ * Reads newline-delimited JSON (JSON Lines): one value per line, blank lines
+ * skipped. The input is a buffer, a file, or chunks fed as they arrive. Every
+ * record is parsed into the same document, whose arena keeps its memory, so a
+ * reader in steady state does not allocate for values. A malformed record
+ * does not stop the reader; its line is already delimited, so moving on is a
+ * matter of calling Next() again:
+ *
+ *     JsonLinesReader reader;
+ *     reader.Open("events.ndjson");
+ *     while (reader.Next())
+ *     {
+ *         if (reader.HasParseError()) continue; // GetRecordOffset() tells where
+ *         Use(reader.GetDocument());
+ *     }
+ *
+ * As with JsonDocumentBuilder, the members of an object record become the
+ * document members; any other record becomes the document root, GetRoot().
+ */
+class JsonLinesReader
+{
+private:
+    JsonParser _parser;
+    JsonDocumentBuilder _builder;
+    JsonDocument _document;
+    detail::MappedFile _file;
 
-            case JsonValueType::String:
-                GenKey(tmp_result, member.first);
-                tmp_result += "\"";
-                tmp_result += member.second.GetString();
-                tmp_result += "\"";
-                break;
+    // Input not consumed yet. _data_offset is the stream offset of _data[0].
+    const char* _data;
+    size_t _size;
+    size_t _position;
+    size_t _data_offset;
+    bool _finished;
+    // A line that began in an earlier chunk, kept until its end arrives.
+    std::string _partial;
+    size_t _partial_offset;
+    bool _partial_active;
+    bool _partial_complete;
 
-            case JsonValueType::Array:
-                GenKey(tmp_result, member.first);
-                GenArray(tmp_result, member.second);
-                break;
+    const char* _record;
+    size_t _record_length;
+    size_t _record_offset;
 
-            case JsonValueType::Object:
-                GenKey(tmp_result, member.first);
-                GenObject(tmp_result, member.second);
-                break;
+    void Start(const char* data, size_t length, bool finished)
+    {
+        _data = data;
+        _size = length;
+        _position = 0;
+        _data_offset = 0;
+        _finished = finished;
+        _partial_active = _partial_complete = false;
+        _record = "";
+        _record_length = _record_offset = 0;
+    }
+    static bool IsBlank(const char* p, size_t length)
+    {
+        for (const char* end = p + length; p < end; ++p)
+        {
+            if (*p != ' ' && *p != '\t' && *p != '\r') return false;
+        }
+        return true;
+    }
+    // Moves to the next non-blank line. False when no complete line is left.
+    bool NextLine()
+    {
+        for (;;)
+        {
+            if (_partial_complete)
+            {
+                _partial_active = _partial_complete = false;
+                _record = _partial.data();
+                _record_length = _partial.size();
+                _record_offset = _partial_offset;
+            }
+            else if (_position < _size)
+            {
+                const char* begin = _data + _position;
+                const char* newline = static_cast<const char*>(std::memchr(begin, '\n', _size - _position));
+                if (newline == nullptr && !_finished)
+                {
+                    _partial.assign(begin, _size - _position);
+                    _partial_offset = _data_offset + _position;
+                    _partial_active = true;
+                    _position = _size;
+                    return false;
+                }
+                const char* end = newline != nullptr ? newline : _data + _size;
+                _record = begin;
+                _record_length = end - begin;
+                _record_offset = _data_offset + _position;
+                _position = end - _data + (newline != nullptr);
             }
-            if (++i < members.size()) tmp_result += ",";
+            else return false;
+            if (!IsBlank(_record, _record_length)) return true;
         }
-        tmp_result += "}";
-        return tmp_result;
+    }
+
+public:
+    JsonLinesReader()
+    {
+        Start("", 0, true);
+    }
+    JsonLinesReader(const JsonLinesReader&) = delete;
+    JsonLinesReader& operator=(const JsonLinesReader&) = delete;
+
+    // Reads the records in [data, data + length), which must stay alive.
+    void Reset(const char* data, size_t length)
+    {
+        _file.Close();
+        Start(data, length, true);
+    }
+    // Reads the records of a file, mapped into memory.
+    bool Open(const char* path)
+    {
+        Start("", 0, true);
+        if (!_file.Open(path)) return false;
+        Start(_file.GetData(), _file.GetSize(), true);
+        return true;
+    }
+
+    /**
+     * Chunked input: call Feed() with the next chunk whenever Next() returns
+     * false, and Finish() after the last one. A line may span any number of
+     * chunks. The chunk has to stay alive until Next() returns false.
+     */
+    void Feed(const char* data, size_t length)
+    {
+        _data_offset += _size;
+        _data = data;
+        _size = length;
+        _position = 0;
+        _finished = false;
+        if (!_partial_active) return;
+        const char* newline = static_cast<const char*>(std::memchr(data, '\n', length));
+        const size_t taken = newline != nullptr ? newline - data : length;
+        _partial.append(data, taken);
+        _position = taken + (newline != nullptr);
+        _partial_complete = newline != nullptr;
+    }
+    // Ends chunked input; a last line without a newline becomes a record.
+    void Finish()
+    {
+        _finished = true;
+        if (_partial_active) _partial_complete = true;
+    }
+
+    /**
+     * Parses the next record into GetDocument(). Returns false at the end of
+     * the input, or in chunked mode when more input is needed.
+     */
+    bool Next()
+    {
+        if (!NextLine()) return false;
+        _document.Clear();
+        _builder.Reset(_document);
+        if (!_parser.Parse(_record, _record_length, _builder)) _document.Clear();
+        return true;
+    }
+    // Reports the next record to a SAX handler instead.
+    template <typename Handler>
+    bool Next(Handler& handler)
+    {
+        if (!NextLine()) return false;
+        _parser.Parse(_record, _record_length, handler);
+        return true;
+    }
+
+    // The last record read. Valid until the next call to Next().
+    JsonDocument& GetDocument()
+    {
+        return _document;
+    }
+    std::string_view GetRecord() const
+    {
+        return std::string_view(_record, _record_length);
+    }
+    // Byte offset of the last record from the start of the input.
+    size_t GetRecordOffset() const
+    {
+        return _record_offset;
+    }
+
+    bool HasParseError() const
+    {
+        return _parser.HasParseError();
+    }
+    JsonParseError GetParseError() const
+    {
+        return _parser.GetParseError();
+    }
+    // Byte offset of the error within the record.
+    size_t GetErrorOffset() const
+    {
+        return _parser.GetErrorOffset();
     }
 };
-class JsonParser
+
+// A record delivered by JsonParallelLinesParser.
+struct JsonLinesRecord
+{
+    size_t offset; // of the line within the input
+    std::string_view text;
+    JsonParseError error; // None unless the line is malformed
+    JsonDocument* document; // empty when error is set
+};
+
+namespace detail
+{
+
+// Worker threads for a requested thread_count: 0 means one per hardware
+// thread, or a single one when that is unknown.
+inline size_t ResolveThreadCount(size_t thread_count)
+{
+    if (thread_count == 0) thread_count = std::thread::hardware_concurrency();
+    return thread_count != 0 ? thread_count : 1;
+}
+// Runs work(i) for every i below thread_count and returns when all are done.
+// Worker 0 runs on the calling thread, each other one on a thread of its own.
+template <typename Work>
+void RunWorkers(size_t thread_count, Work&& work)
+{
+    std::vector<std::thread> threads;
+    if (thread_count > 1) threads.reserve(thread_count - 1);
+    for (size_t i = 1; i < thread_count; ++i) threads.emplace_back([&work, i]() { work(i); });
+    if (thread_count != 0) work(size_t(0));
+    for (std::thread& thread : threads) thread.join();
+}
+
+} // namespace detail
+
+/**
+ * Parses a large newline-delimited JSON buffer on several threads. The buffer
+ * is cut into chunks at line boundaries, and worker threads claim chunks from
+ * a shared cursor, so faster threads simply take more of them. Every worker
+ * parses with its own reader and documents, and therefore its own arenas,
+ * which keep their memory from chunk to chunk.
+ */
+class JsonParallelLinesParser
 {
 private:
-    std::string::const_iterator _it;
-    std::string::const_iterator _it_end;
+    struct Worker
+    {
+        JsonLinesReader reader;
+        JsonDocumentBuilder builder;
+        // Documents of the chunk being delivered in order. A deque keeps them
+        // in place while it grows. Their values all live in arena, which is
+        // reset for every chunk, so a record costs no arena chunk of its own.
+        std::deque<JsonDocument> documents;
+        JsonArena arena;
+        std::vector<JsonLinesRecord> records;
+    };
+
+    size_t _thread_count;
+    size_t _chunk_size;
+
+    static JsonLinesRecord MakeRecord(size_t chunk_offset, JsonLinesReader& reader, JsonDocument& document)
+    {
+        JsonLinesRecord record;
+        record.offset = chunk_offset + reader.GetRecordOffset();
+        record.text = reader.GetRecord();
+        record.error = reader.GetParseError();
+        record.document = &document;
+        return record;
+    }
+    static void ParseChunk(Worker& worker, const char* data, size_t begin, size_t end)
+    {
+        worker.reader.Reset(data + begin, end - begin);
+        worker.records.clear();
+        worker.arena.Reset();
+        for (size_t count = 0;; ++count)
+        {
+            if (count == worker.documents.size()) worker.documents.emplace_back();
+            JsonDocument& document = worker.documents[count];
+            document.Clear();
+            worker.builder.Reset(document, worker.arena);
+            if (!worker.reader.Next(worker.builder)) break;
+            if (worker.reader.HasParseError()) document.Clear();
+            worker.records.push_back(MakeRecord(begin, worker.reader, document));
+        }
+    }
+
+public:
+    // thread_count 0 uses one thread per hardware thread.
+    explicit JsonParallelLinesParser(size_t thread_count = 0) :_thread_count(detail::ResolveThreadCount(thread_count)), _chunk_size(1 << 20) {}
 
-    JsonDocument ParseJson()
+    size_t GetThreadCount() const
     {
-        if (*_it == '{')
+        return _thread_count;
+    }
+    // Approximate bytes per chunk; every chunk is extended to the end of its
+    // last line.
+    void SetChunkSize(size_t chunk_size)
+    {
+        _chunk_size = chunk_size != 0 ? chunk_size : 1;
+    }
+
+    /**
+     * Parses the records in [data, data + length) and calls
+     * callback(const JsonLinesRecord&) for each of them. The record's document
+     * is only valid during the call. A malformed line does not stop the parse;
+     * its record carries the error.
+     *
+     * With ordered set, records arrive in input order, one at a time. Otherwise
+     * they arrive as soon as they are parsed, from all workers concurrently, so
+     * the callback has to be thread-safe. Either way it must not throw.
+     */
+    template <typename Callback>
+    void Parse(const char* data, size_t length, Callback callback, bool ordered = true)
+    {
+        std::vector<size_t> bounds(1, 0);
+        while (bounds.back() < length)
         {
-            _it++;
-            _it_end--;
-            JsonDocument doc;
+            size_t cut = bounds.back() + _chunk_size;
+            if (cut < length)
+            {
+                const char* newline = static_cast<const char*>(std::memchr(data + cut, '\n', length - cut));
+                cut = newline != nullptr ? newline - data + 1 : length;
+            }
+            else cut = length;
+            bounds.push_back(cut);
+        }
+        const size_t chunk_count = bounds.size() - 1;
 
-            bool isKey = false;
-            std::string key_word;
-            for (; _it != _it_end; ++_it)
+        std::atomic<size_t> cursor(0);
+        std::mutex mutex;
+        std::condition_variable turn;
+        size_t delivered = 0;
+        auto work = [&](size_t)
+        {
+            Worker worker;
+            for (;;)
             {
-                switch (*_it)
-                {
-                case 'n':
+                const size_t chunk = cursor.fetch_add(1);
+                if (chunk >= chunk_count) break;
+                if (!ordered)
                 {
-                    isKey = false;
-                    doc.AddMember(key_word, JsonValue(JsonValueType::Null));
+                    worker.reader.Reset(data + bounds[chunk], bounds[chunk + 1] - bounds[chunk]);
+                    while (worker.reader.Next())
+                    {
+                        callback(MakeRecord(bounds[chunk], worker.reader, worker.reader.GetDocument()));
+                    }
+                    continue;
                 }
-                break;
+                // Chunks are claimed in order, so every earlier chunk is
+                // already being parsed and the wait always ends. A worker
+                // holds one parsed chunk at most, so none gets further ahead
+                // of the delivered records than one chunk per thread.
+                ParseChunk(worker, data, bounds[chunk], bounds[chunk + 1]);
+                std::unique_lock<std::mutex> lock(mutex);
+                turn.wait(lock, [&]() { return delivered == chunk; });
+                lock.unlock();
+                for (const JsonLinesRecord& record : worker.records) callback(record);
+                lock.lock();
+                delivered++;
+                lock.unlock();
+                turn.notify_all();
+            }
+        };
+
+        detail::RunWorkers(_thread_count < chunk_count ? _thread_count : chunk_count, work);
+    }
+};
+
+
+/**
+ * Parses a document whose root is one large array on several threads. A
+ * sequential pre-scan builds the structural index a window at a time and
+ * cuts the array at top-level commas into batches of whole elements, keeping
+ * the index of each batch. Worker threads claim batches from a shared cursor,
+ * parse them from that index with their own parser into their own arena, and
+ * move the elements straight into their slots of the root array. The
+ * document then takes over the arenas of the workers, so nothing is copied a
+ * second time.
+ *
+ * Other roots, and input the pre-scan cannot split, are parsed sequentially.
+ * Malformed input is parsed again sequentially as well, so the errors are the
+ * ones JsonParser reports.
+ */
+class JsonParallelArrayParser
+{
+private:
+    // count elements of the root array, starting with element first, that
+    // lie in [begin, end) of the input. Their structural index is
+    // [index_begin, index_end) of _structurals, relative to begin.
+    struct Batch
+    {
+        size_t begin;
+        size_t end;
+        size_t first;
+        size_t count;
+        size_t index_begin;
+        size_t index_end;
+    };
+    struct Worker
+    {
+        JsonParser parser;
+        JsonDocumentBuilder builder;
+        JsonDocument document; // owns the arena the elements are built in
+    };
+
+    static const size_t kWindowSize = detail::StructuralBuffer::kWindowSize;
 
-                case 't':
-                case 'f':
+    size_t _thread_count;
+    size_t _chunk_size;
+    detail::StructuralBuffer _structurals; // of the batches, reused between calls
+    JsonParser _parser; // for everything that is not split
+    JsonParseError _error;
+    size_t _error_offset;
+
+    // Returns false when json is not a single array that can be cut up.
+    // Every batch ends up with its index in _structurals, so the workers do
+    // not index the input a second time.
+    bool Split(const char* json, size_t length, std::vector<Batch>& batches)
+    {
+        size_t count = 0;
+        detail::JsonStructuralIndexer indexer;
+        const detail::SimdLevel level = detail::DetectSimdLevel();
+        size_t depth = 0;
+        bool closed = false;
+        bool empty = true;
+        Batch batch = { 0, 0, 0, 1, 0, 0 };
+        for (size_t window = 0; window < length; window += kWindowSize)
+        {
+            const size_t size = length - window < kWindowSize ? length - window : kWindowSize;
+            // The window is indexed behind the entries kept so far and
+            // compacted into them as it is walked.
+            uint32_t* offsets = _structurals.ReserveWindow(count);
+            const size_t indexed = indexer.IndexWindow(json + window, size, offsets, level);
+            for (size_t i = 0; i < indexed; ++i)
+            {
+                const size_t offset = window + offsets[i];
+                const char c = json[offset];
+                if (depth == 0)
                 {
-                    isKey = false;
-                    JsonValue value;
-                    value.SetBoolean(ParseBoolean());
-                    doc.AddMember(key_word, value);
+                    if (closed || c != '[') return false;
+                    depth = 1;
+                    batch.begin = offset + 1;
+                    continue;
                 }
-                break;
-
-                case '\"':
+                switch (c)
                 {
-                    if (isKey == false)
-                    {
-                        isKey = true;
-                        key_word = ParseString();
-                    }
-                    else
+                case '[':
+                case '{':
+                    depth++;
+                    break;
+                case ']':
+                case '}':
+                    if (--depth != 0) break;
+                    if (c != ']') return false;
+                    closed = true;
+                    batch.end = offset;
+                    batch.index_end = count;
+                    if (!empty) batches.push_back(batch);
+                    continue;
+                case ',':
+                    if (depth != 1) break;
+                    if (offset - batch.begin < _chunk_size)
                     {
-                        isKey = false;
-                        JsonValue value;
-                        value.SetString(ParseString());
-                        doc.AddMember(key_word, value);
+                        batch.count++;
+                        break;
                     }
+                    batch.end = offset;
+                    batch.index_end = count;
+                    batches.push_back(batch);
+                    batch.begin = offset + 1;
+                    batch.first += batch.count;
+                    batch.count = 1;
+                    batch.index_begin = count;
+                    empty = false;
+                    continue;
+                default:
+                    break;
                 }
-                break;
+                // A batch of 4 GiB or more is left to the sequential parser,
+                // which rejects it.
+                if (offset - batch.begin > UINT32_MAX) return false;
+                _structurals.Data()[count++] = static_cast<uint32_t>(offset - batch.begin);
+                empty = false;
+            }
+        }
+        return closed && !indexer.IsInString();
+    }
+    JsonDocument ParseSequential(const char* json, size_t length)
+    {
+        JsonDocument doc = _parser.Parse(json, length);
+        _error = _parser.GetParseError();
+        _error_offset = _parser.GetErrorOffset();
+        return doc;
+    }
 
-                case '[':
-                {
-                    isKey = false;
-                    doc.AddMember(key_word, ParseArray());
-                }
-                break;
+public:
+    // thread_count 0 uses one thread per hardware thread.
+    explicit JsonParallelArrayParser(size_t thread_count = 0)
+        :_thread_count(detail::ResolveThreadCount(thread_count)), _chunk_size(1 << 20), _error(JsonParseError::None), _error_offset(0) {}
 
-                case '{':
-                {
-                    isKey = false;
-                    doc.AddMember(key_word, ParseObject());
-                }
-                break;
+    size_t GetThreadCount() const
+    {
+        return _thread_count;
+    }
+    // Approximate bytes per batch; every batch is extended to the end of its
+    // last element.
+    void SetChunkSize(size_t chunk_size)
+    {
+        _chunk_size = chunk_size != 0 ? chunk_size : 1;
+    }
+
+    JsonDocument Parse(const std::string& json_str)
+    {
+        return Parse(json_str.data(), json_str.size());
+    }
+    /**
+     * Parses json into a document whose root holds the elements of the array,
+     * see JsonDocument::GetRoot(). The whole array is in memory anyway, so
+     * only the elements themselves limit the size of the input, not the
+     * 4 GiB JsonParser accepts.
+     */
+    JsonDocument Parse(const char* json, size_t length)
+    {
+        _error = JsonParseError::None;
+        _error_offset = 0;
+        std::vector<Batch> batches;
+        if (!Split(json, length, batches)) return ParseSequential(json, length);
+        const size_t element_count = batches.empty() ? 0 : batches.back().first + batches.back().count;
+        if (element_count > UINT32_MAX) return ParseSequential(json, length);
+
+        JsonDocument doc;
+        JsonValue* elements = nullptr;
+        if (element_count != 0)
+        {
+            elements = static_cast<JsonValue*>(doc._arena.Allocate(element_count * sizeof(JsonValue), alignof(JsonValue)));
+        }
 
-                case '1':
-                case '2':
-                case '3':
-                case '4':
-                case '5':
-                case '6':
-                case '7':
-                case '8':
-                case '9':
-                case '0':
+        const size_t thread_count = _thread_count < batches.size() ? _thread_count : batches.size();
+        std::vector<Worker> workers(thread_count);
+        std::atomic<size_t> cursor(0);
+        std::atomic<bool> failed(false);
+        std::mutex mutex;
+        size_t failed_batch = SIZE_MAX;
+        auto work = [&](Worker& worker)
+        {
+            while (!failed.load(std::memory_order_relaxed))
+            {
+                const size_t index = cursor.fetch_add(1);
+                if (index >= batches.size()) break;
+                const Batch& batch = batches[index];
+                worker.builder.Reset(worker.document);
+                size_t count = 0;
+                if (!worker.parser.ParseElements(json + batch.begin, batch.end - batch.begin, _structurals.Data() + batch.index_begin,
+                    batch.index_end - batch.index_begin, worker.builder, count) || count != batch.count)
                 {
-                    isKey = false;
-                    JsonValue value(JsonValueType::Number);
-                    value.SetNumberString(ParseNumber());
-                    doc.AddMember(key_word, value);
+                    // Keep the error of the first malformed batch.
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (index < failed_batch)
+                    {
+                        failed_batch = index;
+                        _error = worker.parser.GetParseError();
+                        _error_offset = batch.begin + worker.parser.GetErrorOffset();
+                    }
+                    failed = true;
+                    break;
                 }
-                break;
-
-                default:
-                    continue;
+                JsonValue& array = worker.document._root;
+                for (size_t i = 0; i < count; ++i)
+                {
+                    (new (elements + batch.first + i) JsonValue())->RawMoveFrom(array._elements[i]);
                 }
+                array = JsonValue();
             }
-            return doc;
+        };
+        detail::RunWorkers(thread_count, [&](size_t i) { work(workers[i]); });
+
+        if (failed)
+        {
+            // The sequential parser reports errors in input order and with
+            // the same codes, but cannot take more than 4 GiB.
+            if (length <= UINT32_MAX) return ParseSequential(json, length);
+            return JsonDocument();
         }
-        else return JsonDocument();
+        for (Worker& worker : workers) doc._arena.Adopt(worker.document._arena);
+        doc._root.Reset(JsonValueType::Array);
+        doc._root._elements = elements;
+        doc._root._size = static_cast<uint32_t>(element_count);
+        doc._has_root = true;
+        return doc;
+    }
+
+    bool HasParseError() const
+    {
+        return _error != JsonParseError::None;
     }
+    JsonParseError GetParseError() const
+    {
+        return _error;
+    }
+    // Byte offset in the input where the error was detected.
+    size_t GetErrorOffset() const
+    {
+        return _error_offset;
+    }
+};
+
+
+/**
+ * A value in unparsed JSON text, read on demand. Looking up a member or an
+ * element walks the raw input and skips the values in between with a quote-
+ * and bracket-aware scan, so nothing that is not asked for is parsed or
+ * allocated. The text must outlive every value taken from it.
+ *
+ * Only what is read is validated. Lookups on a value of the wrong type, of a
+ * missing member or of malformed text give a value for which IsValid() is
+ * false, and the getters of such values return the default, like those of
+ * JsonValue.
+ */
+class JsonLazyValue
+{
+private:
+    const char* _begin; // first byte of the value, nullptr when there is none
+    const char* _end;   // end of the input
 
-    std::string ParseString()
+    static JsonLazyValue At(const char* p, const char* end)
     {
-        _it++;
-        std::string cache;
-        cache.reserve(16);
-        while (*_it != '\"')
+        JsonLazyValue value;
+        if (p < end)
         {
-            cache += *_it;
-            _it++;
+            value._begin = p;
+            value._end = end;
         }
-        _it++;
-        return cache;
+        return value;
     }
-    void ParseNull()
+    const char* SkipWhitespace(const char* p) const
     {
-        _it += 4;
+        while (p < _end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) ++p;
+        return p;
     }
-    bool ParseBoolean()
+    // Position after the value that starts at p, or nullptr when the input
+    // ends inside it.
+    const char* SkipValue(const char* p) const
     {
-        if (*_it == 't')
+        switch (*p)
         {
-            _it += 4;
-            return true;
+        case '{':
+        case '[':
+            return detail::SkipContainer(p, _end);
+        case '\"':
+            return detail::SkipString(p + 1, _end);
+        default:
+            while (p < _end && *p != ',' && *p != ']' && *p != '}' && *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r') ++p;
+            return p;
         }
-        _it += 5;
-        return false;
     }
-    std::string ParseNumber()
+    // Moves past the separator after a member or element. Returns nullptr at
+    // the closing bracket or on malformed input.
+    const char* NextItem(const char* p) const
+    {
+        p = SkipValue(p);
+        if (p == nullptr) return nullptr;
+        p = SkipWhitespace(p);
+        if (p == _end || *p != ',') return nullptr;
+        return SkipWhitespace(p + 1);
+    }
+    // Compares the key text in [name, name_end) with key, decoding escapes
+    // only when there are any.
+    static bool KeyEquals(const char* name, const char* name_end, std::string_view key)
     {
-        std::string cache;
-        while (*_it != ',' || (_it == _it_end) == true)
+        if (detail::FindQuoteOrBackslash(name, name_end) == name_end)
         {
-            if (*_it == '}') break;
-            cache += *_it;
-            _it++;
+            return static_cast<size_t>(name_end - name) == key.size() && std::memcmp(name, key.data(), key.size()) == 0;
         }
-        cache.erase(std::remove_if(cache.begin(), cache.end(), isspace), cache.end());
-        return cache;
+        std::string decoded(name_end - name, '\0');
+        const char* decoded_end = detail::UnescapeString(name, name_end, &decoded[0]);
+        return decoded_end != nullptr && std::string_view(decoded.data(), decoded_end - decoded.data()) == key;
     }
-
-    JsonValue ParseValue()
+    // Converts like JsonValue: doubles out of the range of T saturate.
+    template <typename T>
+    T GetNumber() const
     {
-        for (; _it != _it_end; ++_it)
+        detail::ParsedNumber number;
+        if (GetType() != JsonValueType::Number || detail::ParseNumber(_begin, _end, number) == nullptr) return T();
+        switch (number.type)
         {
-            switch (*_it)
-            {
-            case 'n':
-                return JsonValue(JsonValueType::Null);
-            break;
-
-            case 't':
-            case 'f':
-            {
-                JsonValue value;
-                value.SetBoolean(ParseBoolean());
-                return value;
-            }
-            break;
-
-            case '\"':
-            {
-                JsonValue value;
-                value.SetString(ParseString());
-                return value;
-            }
-            break;
-
-            case '[':
-                return ParseArray();
-                break;
-
-            case '{':
-                return ParseObject();
-                break;
+        case JsonNumberType::Int64: return static_cast<T>(number.int64_value);
+        case JsonNumberType::Uint64: return static_cast<T>(number.uint64_value);
+        default: return detail::ConvertFloating<T>(number.double_value);
+        }
+    }
 
-            case '1':
-            case '2':
-            case '3':
-            case '4':
-            case '5':
-            case '6':
-            case '7':
-            case '8':
-            case '9':
-            case '0':
-            {
-                JsonValue value(JsonValueType::Number);
-                value.SetNumberString(ParseNumber());
-                return value;
-            }
-            break;
+public:
+    JsonLazyValue() :_begin(nullptr), _end(nullptr) {}
+    // The root value of the text in [json, json + length).
+    JsonLazyValue(const char* json, size_t length) :_begin(nullptr), _end(nullptr)
+    {
+        _end = json + length;
+        *this = At(SkipWhitespace(json), _end);
+    }
 
-            default:
-                continue;
-            }
+    bool IsValid() const
+    {
+        return _begin != nullptr;
+    }
+    // Told from the first byte of the value; Null when it is not valid.
+    JsonValueType GetType() const
+    {
+        if (_begin == nullptr) return JsonValueType::Null;
+        switch (*_begin)
+        {
+        case '{': return JsonValueType::Object;
+        case '[': return JsonValueType::Array;
+        case '\"': return JsonValueType::String;
+        case 't': case 'f': return JsonValueType::Boolean;
+        case '-': case '0': case '1': case '2': case '3': case '4':
+        case '5': case '6': case '7': case '8': case '9':
+            return JsonValueType::Number;
+        default: return JsonValueType::Null;
         }
-        return JsonValue();
     }
-    JsonValue ParseArray()
+
+    // The member named key of an object; the first one if the name repeats.
+    JsonLazyValue operator[](std::string_view key) const
     {
-        _it++;
-        JsonValue value(JsonValueType::Array);
-        while (*_it != ']')
+        if (GetType() != JsonValueType::Object) return JsonLazyValue();
+        const char* p = SkipWhitespace(_begin + 1);
+        while (p < _end && *p == '\"')
         {
-            if (*_it == ',' || *_it == ' ' || *_it == '\n')
-            {
-                _it++;
-            }
-            else value.AddElement(ParseValue());
+            const char* name = p + 1;
+            p = detail::SkipString(name, _end);
+            if (p == nullptr) break;
+            const bool match = KeyEquals(name, p - 1, key);
+            p = SkipWhitespace(p);
+            if (p == _end || *p != ':') break;
+            p = SkipWhitespace(p + 1);
+            if (p == _end) break;
+            if (match) return At(p, _end);
+            p = NextItem(p);
+            if (p == nullptr) break;
         }
-        return value;
+        return JsonLazyValue();
     }
-    JsonValue ParseObject()
+    // The element at index of an array.
+    JsonLazyValue operator[](size_t index) const
     {
-        _it++;
-        JsonValue refValue(JsonValueType::Object);
-        while (*_it != '}')
+        if (GetType() != JsonValueType::Array) return JsonLazyValue();
+        const char* p = SkipWhitespace(_begin + 1);
+        if (p == _end || *p == ']') return JsonLazyValue();
+        for (size_t i = 0; i < index; ++i)
         {
-            if (*_it == ',' || *_it == ' ' || *_it == '\n')
-            {
-                _it++;
-            }
-            else
-            {
-                std::string key = ParseString();
-                JsonValue value = ParseValue();
-                refValue.AddMember(key, value);
-            }
+            p = NextItem(p);
+            if (p == nullptr) return JsonLazyValue();
         }
-        _it++;
-        return refValue;
+        return At(p, _end);
+    }
+
+    bool IsNull() const
+    {
+        return _begin != nullptr && _end - _begin >= 4 && std::memcmp(_begin, "null", 4) == 0;
+    }
+    bool GetBoolean() const
+    {
+        return _begin != nullptr && _end - _begin >= 4 && std::memcmp(_begin, "true", 4) == 0;
+    }
+    int GetInt() const
+    {
+        return GetNumber<int>();
+    }
+    int64_t GetInt64() const
+    {
+        return GetNumber<int64_t>();
+    }
+    uint64_t GetUint64() const
+    {
+        return GetNumber<uint64_t>();
+    }
+    double GetDouble() const
+    {
+        return GetNumber<double>();
     }
-    
+    // The decoded text of a string value.
+    std::string GetString() const
+    {
+        if (GetType() != JsonValueType::String) return std::string();
+        const char* text = _begin + 1;
+        const char* text_end = detail::SkipString(text, _end);
+        if (text_end == nullptr) return std::string();
+        std::string str(text, text_end - 1);
+        const char* str_end = detail::UnescapeString(str.data(), str.data() + str.size(), &str[0]);
+        if (str_end == nullptr) return std::string();
+        str.resize(str_end - str.data());
+        return str;
+    }
+    // The unparsed text of the value, e.g. to hand a subtree to JsonParser.
+    std::string_view GetRaw() const
+    {
+        if (_begin == nullptr) return std::string_view();
+        const char* value_end = SkipValue(_begin);
+        if (value_end == nullptr) return std::string_view();
+        return std::string_view(_begin, value_end - _begin);
+    }
+};
+
+/**
+ * On-demand view of a JSON document: nothing is parsed up front, and
+ * doc["a"]["b"] finds the value by walking the text (see JsonLazyValue).
+ * Suits reading a few fields out of a large document once. The text must
+ * outlive the document.
+ */
+class JsonLazyDocument
+{
+private:
+    JsonLazyValue _root;
+
 public:
-    JsonParser() {}
+    JsonLazyDocument() {}
+    explicit JsonLazyDocument(const std::string& json) :_root(json.data(), json.size()) {}
+    // The document would point into a string that is gone after the statement.
+    explicit JsonLazyDocument(const std::string&&) = delete;
+    JsonLazyDocument(const char* json, size_t length) :_root(json, length) {}
 
-    JsonDocument Parse(const std::string& json_str)
+    const JsonLazyValue& GetRoot() const
+    {
+        return _root;
+    }
+    JsonLazyValue operator[](std::string_view key) const
+    {
+        return _root[key];
+    }
+    JsonLazyValue operator[](size_t index) const
     {
-        if (json_str.empty()) return JsonDocument();
-        _it = json_str.begin();
-        _it_end = json_str.end();
-        return ParseJson();
+        return _root[index];
     }
 };
 
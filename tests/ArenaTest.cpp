@@ -0,0 +1,119 @@
+// Arena tests: parsed values live in the arena of their document. Build and
+// run under the address sanitizer, which also reports leaks, e.g.
+//   c++ -std=c++17 -g -fsanitize=address,undefined -Iinclude tests/ArenaTest.cpp -o arena_test && ./arena_test
+
+#include "AposaJson/AposaJson.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace AposaJson;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); std::exit(1); } } while (0)
+
+// Allocations are aligned, may be larger than a chunk, and stay valid until
+// the arena is reset. Adopted chunks live as long as the adopting arena.
+static void TestAllocate()
+{
+    JsonArena arena;
+    std::vector<char*> blocks;
+    for (size_t size : { size_t(1), size_t(3), size_t(16), size_t(5000), size_t(1) << 21, size_t(7) })
+    {
+        char* block = static_cast<char*>(arena.Allocate(size, 16));
+        CHECK(reinterpret_cast<uintptr_t>(block) % 16 == 0);
+        std::memset(block, static_cast<int>(size & 0x7F), size);
+        blocks.push_back(block);
+    }
+    CHECK(blocks[4][(size_t(1) << 21) - 1] == 0);
+    CHECK(blocks[3][4999] == static_cast<char>(5000 & 0x7F));
+    CHECK(std::strcmp(arena.CopyString("abc", 3), "abc") == 0);
+    CHECK(arena.CopyString(nullptr, 0)[0] == '\0');
+
+    JsonArena other;
+    const char* adopted = other.CopyString("kept by the adopting arena", 26);
+    arena.Adopt(other);
+    CHECK(std::strcmp(adopted, "kept by the adopting arena") == 0);
+    CHECK(std::strcmp(other.CopyString("other is empty", 14), "other is empty") == 0);
+    arena.Reset();
+    CHECK(std::strcmp(arena.CopyString("after reset", 11), "after reset") == 0);
+    JsonArena last;
+    const char* moved = last.CopyString("moved", 5);
+    arena = std::move(last);
+    CHECK(std::strcmp(moved, "moved") == 0);
+}
+
+// Documents built through one shared arena stay valid as long as that arena,
+// whatever happens to the builder.
+static void TestSharedArena()
+{
+    JsonArena arena;
+    std::vector<JsonDocument> docs(100);
+    {
+        JsonParser parser;
+        JsonDocumentBuilder builder;
+        for (size_t i = 0; i < docs.size(); ++i)
+        {
+            builder.Reset(docs[i], arena);
+            const std::string json = "{\"id\":" + std::to_string(i) + ",\"name\":\"a name long enough to need the arena " + std::to_string(i) + "\",\"list\":[1,[2]]}";
+            CHECK(parser.Parse(json.data(), json.size(), builder));
+        }
+    }
+    for (size_t i = 0; i < docs.size(); ++i)
+    {
+        CHECK(docs[i]["id"].GetUint64() == i);
+        CHECK(docs[i]["name"].GetStringView() == "a name long enough to need the arena " + std::to_string(i));
+        CHECK(docs[i]["list"].GetArray()[1].GetArray()[0].GetInt() == 2);
+    }
+}
+
+// Arena-backed arrays and strings can be changed in place: the value moves
+// to its own heap storage first and neither leaks nor frees arena memory.
+static void TestModifyParsedValues()
+{
+    JsonParser parser;
+    JsonDocument doc = parser.Parse(R"({"list":[1,"two",[3]],"text":"parsed text","empty":[]})");
+    CHECK(!parser.HasParseError());
+    for (int i = 0; i < 100; ++i) doc["list"].AddElement(JsonValue(JsonValueType::Array));
+    doc["list"].EmplaceElement(JsonValueType::Object).AddMember("k", JsonValue());
+    doc["empty"].AddElement(doc["text"]);
+    doc["text"].SetString(std::string(64, 't'));
+
+    const JsonArray list = doc["list"].GetArray();
+    CHECK(list.size() == 104);
+    CHECK(list[1].GetStringView() == "two");
+    CHECK(list[2].GetArray()[0].GetInt() == 3);
+    CHECK(doc["empty"].GetArray()[0].GetStringView() == "parsed text");
+    CHECK(doc["text"].GetStringLength() == 64);
+}
+
+// A document that is cleared and built again reuses its arena; the new values
+// do not depend on the old ones.
+static void TestClearAndReuse()
+{
+    JsonParser parser;
+    JsonDocument doc;
+    JsonDocumentBuilder builder(doc);
+    for (int i = 0; i < 20; ++i)
+    {
+        doc.Clear();
+        builder.Reset(doc);
+        const std::string json = "[\"" + std::string(100 + i, 'a' + i) + "\"," + std::to_string(i) + "]";
+        CHECK(parser.Parse(json.data(), json.size(), builder));
+        CHECK(doc.GetRoot().GetArray()[0].GetStringView() == std::string(100 + i, 'a' + i));
+        CHECK(doc.GetRoot().GetArray()[1].GetInt() == i);
+    }
+}
+
+int main()
+{
+    TestAllocate();
+    TestSharedArena();
+    TestModifyParsedValues();
+    TestClearAndReuse();
+    std::printf("ArenaTest passed\n");
+    return 0;
+}
@@ -0,0 +1,56 @@
+// Document root tests. Build and run, e.g.
+//   c++ -std=c++17 -g -fsanitize=address,undefined -Iinclude tests/DocumentTest.cpp -o document_test && ./document_test
+
+#include "AposaJson/AposaJson.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using namespace AposaJson;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); std::exit(1); } } while (0)
+
+// Every root, null included, serializes back to itself.
+static void TestRootRoundTrip()
+{
+    const char* inputs[] = { "null", "{}", "{\"a\":null}", "[]", "[null]", "true", "1", "\"s\"" };
+    JsonSerializer serializer;
+    for (const char* input : inputs)
+    {
+        JsonParser parser;
+        const JsonDocument doc = parser.Parse(input);
+        CHECK(!parser.HasParseError());
+        CHECK(serializer.SerializeObject(doc) == input);
+        const JsonDocument copy(doc);
+        CHECK(serializer.SerializeObject(copy) == input);
+    }
+    CHECK(serializer.SerializeObject(JsonDocument()) == "{}");
+}
+
+// The lines reader reuses its document; a record does not inherit the root
+// of the one before it.
+static void TestLinesRoots()
+{
+    const std::string input = "null\n{\"a\":1}\n[1]\n{}\n";
+    const char* expected[] = { "null", "{\"a\":1}", "[1]", "{}" };
+    JsonLinesReader reader;
+    reader.Reset(input.data(), input.size());
+    JsonSerializer serializer;
+    size_t count = 0;
+    while (reader.Next())
+    {
+        CHECK(!reader.HasParseError());
+        CHECK(serializer.SerializeObject(reader.GetDocument()) == expected[count]);
+        ++count;
+    }
+    CHECK(count == 4);
+}
+
+int main()
+{
+    TestRootRoundTrip();
+    TestLinesRoots();
+    std::printf("DocumentTest passed\n");
+    return 0;
+}
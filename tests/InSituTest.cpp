@@ -0,0 +1,116 @@
+// In-situ parsing tests. Build and run under the address sanitizer, e.g.
+//   c++ -std=c++17 -g -fsanitize=address,undefined -Iinclude tests/InSituTest.cpp -o in_situ_test && ./in_situ_test
+
+#include "AposaJson/AposaJson.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace AposaJson;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); std::exit(1); } } while (0)
+
+static bool PointsInto(std::string_view text, const std::vector<char>& buf)
+{
+    return text.data() >= buf.data() && text.data() + text.size() <= buf.data() + buf.size();
+}
+
+static std::vector<char> Buffer(const std::string& json)
+{
+    return std::vector<char>(json.begin(), json.end());
+}
+
+// Every string and key points into the buffer, the escaped ones too, which
+// are decoded in place.
+static void TestDecodeInPlace()
+{
+    std::vector<char> buf = Buffer(R"({"plain":"text","esc\"aped key":["line\nbreak","café","😀!","back\\slash \/"],"n":1})");
+    JsonParser parser;
+    const JsonDocument doc = parser.ParseInSitu(buf.data(), buf.size());
+    CHECK(!parser.HasParseError());
+
+    for (const auto& member : doc) CHECK(PointsInto(member.first, buf));
+    CHECK(PointsInto(doc.Find("plain")->GetStringView(), buf));
+    const JsonValue* escaped = doc.Find("esc\"aped key");
+    CHECK(escaped != nullptr);
+    const char* expected[] = { "line\nbreak", "caf\xC3\xA9", "\xF0\x9F\x98\x80!", "back\\slash /" };
+    for (size_t i = 0; i < 4; ++i)
+    {
+        const std::string_view text = escaped->GetArray()[i].GetStringView();
+        CHECK(PointsInto(text, buf));
+        CHECK(text == expected[i]);
+    }
+}
+
+// A copy of the document owns its text, so it outlives the buffer.
+static void TestCopyOutlivesBuffer()
+{
+    JsonDocument copy;
+    {
+        std::vector<char> buf = Buffer(R"({"k\tey":{"s":"vAlue"}})");
+        JsonParser parser;
+        copy = parser.ParseInSitu(buf.data(), buf.size());
+        copy = JsonDocument(copy);
+        buf.assign(buf.size(), '#');
+    }
+    CHECK(copy["k\tey"].GetObject()["s"].GetStringView() == "vAlue");
+}
+
+// The SAX form hands out spans of the buffer.
+struct SpanChecker : JsonHandler
+{
+    const std::vector<char>* buf;
+    std::vector<std::string> strings;
+    bool OnString(const char* str, size_t length)
+    {
+        CHECK(PointsInto(std::string_view(str, length), *buf));
+        strings.emplace_back(str, length);
+        return true;
+    }
+    bool OnKey(const char* str, size_t length)
+    {
+        return OnString(str, length);
+    }
+};
+
+static void TestHandler()
+{
+    std::vector<char> buf = Buffer(R"({"a\"b":["été","x"]})");
+    SpanChecker checker;
+    checker.buf = &buf;
+    JsonParser parser;
+    CHECK(parser.ParseInSitu(buf.data(), buf.size(), checker));
+    CHECK(checker.strings.size() == 3);
+    CHECK(checker.strings[0] == "a\"b");
+    CHECK(checker.strings[1] == "\xC3\xA9t\xC3\xA9");
+}
+
+// Malformed input gives the error Parse() gives and an empty document.
+static void TestErrors()
+{
+    const char* inputs[] = { R"(["ok","bad \x"])", R"({"a":"\ud800"})", R"(["a","b")", R"({"a" "b"})" };
+    for (const char* input : inputs)
+    {
+        JsonParser reference;
+        reference.Parse(input);
+        CHECK(reference.HasParseError());
+        std::vector<char> buf = Buffer(input);
+        JsonParser parser;
+        const JsonDocument doc = parser.ParseInSitu(buf.data(), buf.size());
+        CHECK(parser.GetParseError() == reference.GetParseError());
+        CHECK(parser.GetErrorOffset() == reference.GetErrorOffset());
+        CHECK(doc.Empty() && doc.GetRoot().GetType() == JsonValueType::Null);
+    }
+}
+
+int main()
+{
+    TestDecodeInPlace();
+    TestCopyOutlivesBuffer();
+    TestHandler();
+    TestErrors();
+    std::printf("InSituTest passed\n");
+    return 0;
+}
@@ -0,0 +1,112 @@
+// On-demand access tests. Build and run with the float-cast checks on, e.g.
+//   c++ -std=c++17 -g -fsanitize=address,undefined,float-cast-overflow -fno-sanitize-recover=all -Iinclude tests/LazyTest.cpp -o lazy_test && ./lazy_test
+
+#include "AposaJson/AposaJson.hpp"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <type_traits>
+
+using namespace AposaJson;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); std::exit(1); } } while (0)
+
+static_assert(!std::is_constructible<JsonLazyDocument, std::string>::value, "a temporary string would dangle");
+static_assert(std::is_constructible<JsonLazyDocument, const std::string&>::value, "");
+
+// Numbers convert as they do through JsonValue: out-of-range doubles saturate.
+static void TestNumbers()
+{
+    const std::string json = R"({"big":1e20,"small":-1e20,"frac":-0.5,"pi":3.25,"max":18446744073709551615,"neg":-42,"exp":2E3})";
+    const JsonLazyDocument lazy(json);
+    JsonParser parser;
+    const JsonDocument doc = parser.Parse(json);
+    CHECK(!parser.HasParseError());
+
+    const char* keys[] = { "big", "small", "frac", "pi", "max", "neg", "exp" };
+    for (const char* key : keys)
+    {
+        const JsonValue& value = *doc.Find(key);
+        CHECK(lazy[key].GetType() == JsonValueType::Number);
+        CHECK(lazy[key].GetInt() == value.GetInt());
+        CHECK(lazy[key].GetInt64() == value.GetInt64());
+        CHECK(lazy[key].GetUint64() == value.GetUint64());
+        CHECK(lazy[key].GetDouble() == value.GetDouble());
+    }
+    CHECK(lazy["big"].GetInt() == std::numeric_limits<int>::max());
+    CHECK(lazy["small"].GetInt64() == std::numeric_limits<int64_t>::min());
+    CHECK(lazy["small"].GetUint64() == 0);
+    CHECK(lazy["frac"].GetInt() == 0);
+    CHECK(lazy["pi"].GetInt() == 3);
+    CHECK(lazy["max"].GetUint64() == std::numeric_limits<uint64_t>::max());
+    CHECK(lazy["exp"].GetInt() == 2000);
+
+    // Text that only looks like a number is not one.
+    const std::string bad = R"({"minus":-,"dot":1.})";
+    const JsonLazyDocument bad_lazy(bad);
+    CHECK(bad_lazy["minus"].GetInt() == 0);
+    CHECK(bad_lazy["dot"].GetDouble() == 0);
+}
+
+// Missing members, wrong types and malformed text give invalid values whose
+// getters return the defaults.
+static void TestMissing()
+{
+    const std::string json = R"({"a":{"b":[true,false,null]},"s":"text","abc":1})";
+    const JsonLazyDocument doc(json);
+    CHECK(doc["a"]["b"][0].GetBoolean());
+    CHECK(!doc["a"]["b"][1].GetBoolean());
+    CHECK(doc["a"]["b"][2].IsNull());
+    CHECK(doc["abc"].GetInt() == 1);
+
+    CHECK(!doc["missing"].IsValid());
+    CHECK(doc["missing"].GetType() == JsonValueType::Null);
+    CHECK(!doc["missing"]["deeper"][3].IsValid());
+    CHECK(doc["missing"].GetString().empty());
+    CHECK(doc["missing"].GetRaw().empty());
+    CHECK(doc["missing"].GetInt64() == 0);
+    CHECK(!doc["s"]["key"].IsValid());
+    CHECK(!doc["s"][0].IsValid());
+    CHECK(!doc[0].IsValid());
+    CHECK(doc["s"].GetInt() == 0);
+    CHECK(doc["s"].GetString() == "text");
+
+    const std::string truncated = R"({"a":[1,2,{"b":"never closed)";
+    const JsonLazyDocument broken(truncated);
+    CHECK(broken["a"][1].GetInt() == 2);
+    CHECK(!broken["a"][3].IsValid());
+    CHECK(!broken["z"].IsValid());
+    CHECK(broken["a"][2]["b"].GetString().empty());
+}
+
+// Elements are found by index, past nested containers and strings that hold
+// brackets and commas.
+static void TestIndex()
+{
+    const std::string json = R"( [ "a,]", [1, [2, 3]], {"k": "}"}, -7, "\"q\"" ] )";
+    const JsonLazyDocument doc(json);
+    CHECK(doc.GetRoot().GetType() == JsonValueType::Array);
+    CHECK(doc[0].GetString() == "a,]");
+    CHECK(doc[1][1][1].GetInt() == 3);
+    CHECK(doc[1].GetRaw() == "[1, [2, 3]]");
+    CHECK(doc[2]["k"].GetString() == "}");
+    CHECK(doc[3].GetInt() == -7);
+    CHECK(doc[4].GetString() == "\"q\"");
+    CHECK(!doc[5].IsValid());
+    CHECK(!doc[1][2].IsValid());
+
+    const std::string empty = "[]";
+    CHECK(!JsonLazyDocument(empty)[0].IsValid());
+}
+
+int main()
+{
+    TestNumbers();
+    TestMissing();
+    TestIndex();
+    std::printf("LazyTest passed\n");
+    return 0;
+}
@@ -0,0 +1,114 @@
+// Value lifetime tests: values taken out of a document must outlive it. Build
+// and run under the address sanitizer, e.g.
+//   c++ -std=c++17 -g -fsanitize=address,undefined -Iinclude tests/LifetimeTest.cpp -o lifetime_test && ./lifetime_test
+
+#include "AposaJson/AposaJson.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace AposaJson;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); std::exit(1); } } while (0)
+
+static const char* kJson = R"({"a":{"name":"a string longer than any inline buffer","list":[1,"two",{"x":"y"}],"n":-12.5},"b":"short"})";
+static const char* kSubtree = R"({"name":"a string longer than any inline buffer","list":[1,"two",{"x":"y"}],"n":-12.5})";
+
+static std::string Serialize(const JsonValue& value)
+{
+    JsonSerializer serializer;
+    JsonStringWriter writer;
+    serializer.Serialize(value, writer);
+    return writer.GetString();
+}
+
+// A subtree moved out of a parsed document stays valid once the document and
+// its arena are gone, and leaves null behind.
+static void TestMoveOutOfDocument()
+{
+    JsonValue kept;
+    JsonValue string;
+    {
+        JsonParser parser;
+        JsonDocument doc = parser.Parse(kJson);
+        CHECK(!parser.HasParseError());
+        kept = std::move(doc["a"]);
+        JsonValue moved(std::move(doc["b"]));
+        string = std::move(moved);
+        CHECK(doc["a"].GetType() == JsonValueType::Null);
+    }
+    CHECK(Serialize(kept) == kSubtree);
+    CHECK(string.GetStringView() == "short");
+
+    // A copy is as independent as a move.
+    JsonValue copy;
+    {
+        JsonParser parser;
+        const JsonDocument doc = parser.Parse(R"({"r":[{"k":"v"},"w"]})");
+        copy = doc.Find("r") != nullptr ? *doc.Find("r") : JsonValue();
+    }
+    CHECK(Serialize(copy) == R"([{"k":"v"},"w"])");
+}
+
+// A parsed object that is modified in place moves its members out of the
+// arena; they are detached then and survive the document as well.
+static void TestMoveModifiedObject()
+{
+    JsonValue kept;
+    {
+        JsonParser parser;
+        JsonDocument doc = parser.Parse(kJson);
+        doc["a"].AddMember("extra", JsonValue(JsonValueType::Array));
+        kept = std::move(doc["a"]);
+    }
+    const JsonObject object = kept.GetObject();
+    CHECK(object.size() == 4);
+    CHECK(object["name"].GetStringView() == "a string longer than any inline buffer");
+    CHECK(object["list"].GetArray()[2].GetObject()["x"].GetStringView() == "y");
+}
+
+// Zero-copy strings point into the input; moved out, they own their text.
+static void TestMoveZeroCopyString()
+{
+    JsonValue kept;
+    {
+        std::string input = R"({"s":"points into the input buffer"})";
+        JsonParser parser;
+        JsonDocument doc = parser.ParseZeroCopy(input.data(), input.size());
+        kept = std::move(doc["s"]);
+        input.assign(input.size(), 'x');
+    }
+    CHECK(kept.GetStringView() == "points into the input buffer");
+}
+
+// Moving a whole document moves its arena along, so nothing is copied and
+// everything in it stays valid, in particular a root that is not an object.
+static void TestMoveDocument()
+{
+    std::vector<JsonDocument> docs;
+    for (int i = 0; i < 50; ++i)
+    {
+        JsonParser parser;
+        docs.push_back(parser.Parse("[\"element " + std::to_string(i) + " with some padding text\"]"));
+    }
+    JsonDocument last;
+    last = std::move(docs.back());
+    docs.pop_back();
+    for (int i = 0; i < 49; ++i)
+    {
+        CHECK(docs[i].GetRoot().GetArray()[0].GetStringView() == "element " + std::to_string(i) + " with some padding text");
+    }
+    CHECK(last.GetRoot().GetArray()[0].GetStringView() == "element 49 with some padding text");
+}
+
+int main()
+{
+    TestMoveOutOfDocument();
+    TestMoveModifiedObject();
+    TestMoveZeroCopyString();
+    TestMoveDocument();
+    std::printf("LifetimeTest passed\n");
+    return 0;
+}
@@ -0,0 +1,151 @@
+// Object member tests. Build and run under a leak checker, e.g.
+//   c++ -std=c++17 -g -fsanitize=address,undefined -Iinclude tests/MemberTest.cpp -o member_test && ./member_test
+
+#include "AposaJson/AposaJson.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using namespace AposaJson;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); std::exit(1); } } while (0)
+
+// Members of a parsed object live in the document arena. Replacing one must
+// move the block to the heap first, or the new heap-backed value leaks.
+static void TestReplaceParsedMember()
+{
+    JsonParser parser;
+    JsonDocument doc = parser.Parse(R"({"a":{"b":1,"c":2}})");
+    CHECK(!parser.HasParseError());
+
+    JsonValue string_value;
+    string_value.SetString(std::string(100, 'x'));
+    doc["a"].AddMember("b", string_value);
+    doc["a"].EmplaceMember("c", JsonValueType::Array).AddElement(string_value);
+    doc["a"].TryEmplaceMember("c").first->AddElement(string_value);
+
+    const JsonObject object = doc["a"].GetObject();
+    CHECK(object.size() == 2);
+    CHECK(object.begin()->GetKey() == "b");
+    CHECK(object["b"].GetStringLength() == 100);
+    CHECK(object["c"].GetArray().size() == 2);
+}
+
+// Objects built member by member get a hash index once they pass
+// detail::kMemberIndexThreshold, which keeps building and lookups linear.
+static void TestBuildLargeObject()
+{
+    const int count = 40000;
+    JsonValue object;
+    for (int i = 0; i < count; ++i)
+    {
+        object.EmplaceMember("key" + std::to_string(i)).SetInt(i);
+    }
+    object.AddMember("key7", JsonValue(JsonValueType::Array));
+    CHECK(object.GetObject().size() == static_cast<size_t>(count));
+
+    const JsonValue copy(object);
+    for (int i = 0; i < count; ++i)
+    {
+        const std::string key = "key" + std::to_string(i);
+        if (i == 7) continue;
+        CHECK(object.GetObject()[key].GetInt() == i);
+        CHECK(copy.GetObject()[key].GetInt() == i);
+    }
+    CHECK(object.GetObject()["key7"].GetType() == JsonValueType::Array);
+    CHECK(object.GetObject().find("missing") == object.GetObject().end());
+    CHECK(!object.TryEmplaceMember("key9").second);
+}
+
+// A large parsed object keeps answering lookups after it has been moved out
+// of the arena and grown.
+static void TestGrowParsedObject()
+{
+    std::string json = "{";
+    for (int i = 0; i < 100; ++i) json += "\"k" + std::to_string(i) + "\":" + std::to_string(i) + ",";
+    json += "\"k0\":-1}";
+    JsonParser parser;
+    JsonDocument doc = parser.Parse("{\"o\":" + json + "}");
+    CHECK(!parser.HasParseError());
+
+    JsonValue& object = doc["o"];
+    CHECK(object.GetObject()["k0"].GetInt64() == -1);
+    object.AddMember("k1", JsonValue());
+    for (int i = 100; i < 300; ++i) object.EmplaceMember("k" + std::to_string(i)).SetInt(i);
+    CHECK(object.GetObject()["k0"].GetInt64() == -1);
+    CHECK(object.GetObject()["k1"].GetType() == JsonValueType::Null);
+    for (int i = 2; i < 300; ++i) CHECK(object.GetObject()["k" + std::to_string(i)].GetInt64() == i);
+}
+
+// Values moved from one parsed document into another, or into a standalone
+// value, outlive the document they came from.
+static void TestMoveBetweenDocuments()
+{
+    JsonParser parser;
+    JsonDocument out = parser.Parse(R"({"kept":{"list":[]}})");
+    JsonValue object;
+    JsonValue array;
+    {
+        JsonParser source_parser;
+        JsonDocument parsed = source_parser.Parse(R"({"x":{"s":"a string that is not stored inline"},"y":["one","two"],"z":"zzzzzzzzzzzzzzzzzzzzzzzz"})");
+        out.AddMember("x", std::move(parsed["x"]));
+        out["kept"].TryEmplaceMember("list").first->AddElement(std::move(parsed["y"]));
+        out["kept"].EmplaceMember("z", std::move(parsed["z"]));
+        object.AddMember("x", std::move(out["x"]));
+        array.EmplaceElement(std::move(parsed["y"]));
+    }
+    CHECK(object.GetObject()["x"].GetObject()["s"].GetStringView() == "a string that is not stored inline");
+    CHECK(array.GetArray().size() == 1 && array.GetArray()[0].GetType() == JsonValueType::Null);
+    CHECK(out["kept"].GetObject()["list"].GetArray()[0].GetArray()[1].GetStringView() == "two");
+    CHECK(out["kept"].GetObject()["z"].GetStringLength() == 24);
+    JsonSerializer serializer;
+    CHECK(serializer.SerializeObject(out) == R"({"kept":{"list":[["one","two"]],"z":"zzzzzzzzzzzzzzzzzzzzzzzz"},"x":null})");
+}
+
+// Document member keys are views into the document arena. Keys added from
+// temporaries and keys of copied documents stay valid once their source is gone.
+static void TestDocumentKeys()
+{
+    std::string json = "{";
+    for (int i = 0; i < 50; ++i) json += "\"a root member name longer than any inline buffer " + std::to_string(i) + "\":" + std::to_string(i) + ",";
+    json += "\"short\":-1}";
+    JsonDocument copy;
+    {
+        JsonParser parser;
+        JsonDocument doc = parser.Parse(json);
+        CHECK(!parser.HasParseError());
+        doc.AddMember(std::string("an added member name longer than any inline buffer"), JsonValue(JsonValueType::Array));
+        doc.EmplaceMember(std::string(40, 'k')).SetInt(40);
+        doc[std::string(30, 'o')].SetBoolean(true);
+        const JsonDocument first(doc);
+        copy = first;
+    }
+    CHECK(copy.Size() == 54);
+    for (int i = 0; i < 50; ++i) CHECK(copy["a root member name longer than any inline buffer " + std::to_string(i)].GetInt() == i);
+    CHECK(copy.Find("short")->GetInt() == -1);
+    CHECK(copy.Find("an added member name longer than any inline buffer")->GetType() == JsonValueType::Array);
+    CHECK(copy.Find(std::string(40, 'k'))->GetInt() == 40);
+    CHECK(copy.Find(std::string(30, 'o'))->GetBoolean());
+    size_t count = 0;
+    for (const auto& member : copy) count += member.first.size() > 20 ? 1 : 0;
+    CHECK(count == 53);
+
+    // Zero-copy keys point into the input.
+    std::string input = R"({"zero copy key":1})";
+    JsonParser parser;
+    JsonDocument doc = parser.ParseZeroCopy(input.data(), input.size());
+    CHECK(doc.begin()->first.data() == input.data() + 2);
+    CHECK(doc["zero copy key"].GetInt() == 1);
+}
+
+int main()
+{
+    TestReplaceParsedMember();
+    TestBuildLargeObject();
+    TestGrowParsedObject();
+    TestMoveBetweenDocuments();
+    TestDocumentKeys();
+    std::printf("MemberTest passed\n");
+    return 0;
+}
@@ -0,0 +1,91 @@
+// Number conversion tests. Build and run with the float-cast checks on, e.g.
+//   c++ -std=c++17 -g -fsanitize=address,undefined,float-cast-overflow -fno-sanitize-recover=all -Iinclude tests/NumberTest.cpp -o number_test && ./number_test
+
+#include "AposaJson/AposaJson.hpp"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <string>
+
+using namespace AposaJson;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); std::exit(1); } } while (0)
+
+// Doubles outside the range of the requested integer type saturate instead
+// of hitting an undefined conversion.
+static void TestOutOfRangeDoubles()
+{
+    JsonParser parser;
+    JsonDocument doc = parser.Parse(R"({"big":1e20,"small":-1e20,"frac":-0.5,"huge":1e300})");
+    CHECK(!parser.HasParseError());
+
+    CHECK(doc["big"].GetInt() == std::numeric_limits<int>::max());
+    CHECK(doc["big"].GetInt64() == std::numeric_limits<int64_t>::max());
+    CHECK(doc["big"].GetUint64() == std::numeric_limits<uint64_t>::max());
+    CHECK(doc["big"].GetInt16() == std::numeric_limits<short>::max());
+    CHECK(doc["small"].GetInt() == std::numeric_limits<int>::min());
+    CHECK(doc["small"].GetInt64() == std::numeric_limits<int64_t>::min());
+    CHECK(doc["small"].GetUint() == 0);
+    CHECK(doc["frac"].GetInt() == 0);
+    CHECK(doc["frac"].GetUint64() == 0);
+    CHECK(std::isinf(doc["huge"].GetFloat()));
+
+    JsonValue value;
+    value.SetDouble(std::nan(""));
+    CHECK(value.GetInt64() == 0);
+    value.SetFloat(3e9f);
+    CHECK(value.GetInt() == std::numeric_limits<int>::max());
+    value.SetDouble(12345.75);
+    CHECK(value.GetInt() == 12345);
+}
+
+// Doubles survive a serialize/parse round trip, with either conversion
+// backend (define APOSA_JSON_C_FLOAT_CONVERSION to force the C library one).
+static void TestDoubleRoundTrip()
+{
+    const double values[] = { 0.1, 1.0 / 3, 5e-324, 1.7976931348623157e308, -2.5e-8, 123456789.125, 1e22, 1e23 };
+    JsonParser parser;
+    JsonSerializer serializer;
+    for (double value : values)
+    {
+        JsonValue number;
+        number.SetDouble(value);
+        JsonStringWriter writer;
+        serializer.Serialize(number, writer);
+        JsonDocument doc = parser.Parse(writer.GetString());
+        CHECK(!parser.HasParseError());
+        CHECK(doc.GetRoot().GetDouble() == value);
+    }
+    parser.Parse("[1e400]");
+    CHECK(parser.GetParseError() == JsonParseError::InvalidNumber);
+    JsonDocument doc = parser.Parse("[1e-400,-1e-400]");
+    CHECK(!parser.HasParseError());
+    CHECK(doc.GetRoot().GetArray()[0].GetDouble() == 0);
+}
+
+// Numbers kept as text are written as they are.
+static void TestNumberString()
+{
+    const std::string text = "-123456789012345678901234567890.125e-7";
+    JsonValue number;
+    number.SetNumberString(text);
+    CHECK(number.GetNumberStringView() == text);
+    JsonSerializer serializer;
+    JsonStringWriter writer;
+    serializer.Serialize(number, writer);
+    CHECK(writer.GetString() == text);
+
+    number.SetInt(1);
+    CHECK(number.GetNumberStringView().empty());
+}
+
+int main()
+{
+    TestOutOfRangeDoubles();
+    TestDoubleRoundTrip();
+    TestNumberString();
+    std::printf("NumberTest passed\n");
+    return 0;
+}
@@ -0,0 +1,225 @@
+// Parallel parsing tests. Build and run under the address or the thread
+// sanitizer, e.g.
+//   c++ -std=c++17 -g -fsanitize=address,undefined -pthread -Iinclude tests/ParallelTest.cpp -o parallel_test && ./parallel_test
+
+#include "AposaJson/AposaJson.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace AposaJson;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); std::exit(1); } } while (0)
+
+static const size_t kThreadCounts[] = { 1, 2, 3, 8 };
+static const size_t kChunkSizes[] = { 1, 7, 64, 1 << 20 };
+
+// Parses json with every thread count and chunk size and checks that the
+// result, or the error, is the one JsonParser gives.
+static void CheckLikeParse(const std::string& json)
+{
+    JsonParser reference;
+    const JsonDocument expected = reference.Parse(json);
+    JsonSerializer serializer;
+    for (size_t threads : kThreadCounts)
+    {
+        for (size_t chunk : kChunkSizes)
+        {
+            JsonParallelArrayParser parser(threads);
+            parser.SetChunkSize(chunk);
+            const JsonDocument doc = parser.Parse(json);
+            CHECK(parser.GetParseError() == reference.GetParseError());
+            CHECK(parser.GetErrorOffset() == reference.GetErrorOffset());
+            CHECK(serializer.SerializeObject(doc) == serializer.SerializeObject(expected));
+        }
+    }
+}
+
+static void TestArrays()
+{
+    CheckLikeParse("[]");
+    CheckLikeParse(" [ ] ");
+    CheckLikeParse("[1]");
+    CheckLikeParse("[\"only\"]");
+    CheckLikeParse(R"([[1,[2,"a,]"]],{"k":"]},","l":[[],{}]},"x\"],",[],{},-0.5,true,null])");
+    CheckLikeParse("[[[[[[\"deep, nested\"]]]]],[[],[[]]]]");
+
+    std::string many = "[";
+    for (int i = 0; i < 5000; ++i)
+    {
+        if (i != 0) many += ',';
+        many += i % 3 == 0 ? "{\"id\":" + std::to_string(i) + ",\"s\":\"a, b]\"}" : i % 3 == 1 ? "[" + std::to_string(i) + ",[]]" : std::to_string(i);
+    }
+    many += "]";
+    CheckLikeParse(many);
+
+    JsonParallelArrayParser parser(4);
+    parser.SetChunkSize(100);
+    const JsonDocument doc = parser.Parse(many);
+    CHECK(doc.GetRoot().GetArray().size() == 5000);
+    CHECK(doc.GetRoot().GetArray()[4999].GetArray()[0].GetInt() == 4999);
+}
+
+// Malformed input falls back to the sequential parser and reports its error,
+// wherever the batch boundaries fall.
+static void TestMalformed()
+{
+    const char* inputs[] = {
+        "[1,2,{\"a\":},4]",
+        "[1,2,]",
+        "[,1]",
+        "[1,,2]",
+        "[1 2,3]",
+        "[1,2",
+        "[1,[2,3],{\"a\":1]]",
+        "[1,\"open]",
+        "[1,\"\xff\",3]",
+        "[1,tru,3]",
+        "[1,2] 3",
+        "[1,2]]",
+        ""
+    };
+    for (const char* input : inputs) CheckLikeParse(input);
+
+    std::string long_bad = "[";
+    for (int i = 0; i < 1000; ++i) long_bad += std::to_string(i) + ",";
+    long_bad += "{\"bad\" 1},1,2,3]";
+    CheckLikeParse(long_bad);
+}
+
+// Any other root is parsed sequentially.
+static void TestOtherRoots()
+{
+    CheckLikeParse(R"({"a":[1,2,3],"b":"[x,y]"})");
+    CheckLikeParse("\"[1,2]\"");
+    CheckLikeParse("42");
+    CheckLikeParse("null");
+    CheckLikeParse("{}");
+}
+
+// What a lines parse delivered, in delivery order.
+struct Delivered
+{
+    size_t offset;
+    std::string text;
+    JsonParseError error;
+    int64_t id;
+};
+
+static std::vector<Delivered> ParseLines(const std::string& input, size_t threads, size_t chunk, bool ordered)
+{
+    std::vector<Delivered> delivered;
+    std::mutex mutex;
+    JsonParallelLinesParser parser(threads);
+    parser.SetChunkSize(chunk);
+    parser.Parse(input.data(), input.size(), [&](const JsonLinesRecord& record)
+    {
+        CHECK(input.compare(record.offset, record.text.size(), record.text) == 0);
+        const JsonValue* id = record.document->Find("id");
+        if (record.error != JsonParseError::None) CHECK(record.document->Empty() && id == nullptr);
+        std::lock_guard<std::mutex> lock(mutex);
+        delivered.push_back({ record.offset, std::string(record.text), record.error, id != nullptr ? id->GetInt64() : -1 });
+    }, ordered);
+    return delivered;
+}
+
+// Every line is delivered exactly once, and in input order when ordered,
+// across thread counts and chunk sizes. Blank lines are skipped and a last
+// line without a newline is a record too.
+static void TestLines()
+{
+    const int count = 2000;
+    std::string input;
+    for (int i = 0; i < count; ++i)
+    {
+        input += "{\"id\":" + std::to_string(i) + ",\"s\":\"line\\n " + std::string(i % 13, 'x') + "\"}";
+        if (i != count - 1) input += i % 7 == 0 ? "\n\n" : "\n";
+    }
+    for (size_t threads : kThreadCounts)
+    {
+        for (size_t chunk : kChunkSizes)
+        {
+            for (bool ordered : { true, false })
+            {
+                std::vector<Delivered> delivered = ParseLines(input, threads, chunk, ordered);
+                CHECK(delivered.size() == static_cast<size_t>(count));
+                if (!ordered)
+                {
+                    std::sort(delivered.begin(), delivered.end(), [](const Delivered& a, const Delivered& b) { return a.offset < b.offset; });
+                }
+                for (int i = 0; i < count; ++i)
+                {
+                    CHECK(delivered[i].error == JsonParseError::None);
+                    CHECK(delivered[i].id == i);
+                    if (i != 0) CHECK(delivered[i].offset > delivered[i - 1].offset);
+                }
+                CHECK(delivered.back().offset + delivered.back().text.size() == input.size());
+            }
+        }
+    }
+
+    for (bool ordered : { true, false })
+    {
+        CHECK(ParseLines("", 4, 1, ordered).empty());
+        CHECK(ParseLines("\n\n \n", 4, 1, ordered).empty());
+        const std::vector<Delivered> last = ParseLines("{\"id\":1}\n{\"id\":2}", 2, 1, ordered);
+        CHECK(last.size() == 2);
+        CHECK(last[0].id + last[1].id == 3);
+    }
+}
+
+// A malformed line is delivered with the error JsonParser gives and an empty
+// document. It does not stop the parse: the lines after it still arrive.
+static void TestMalformedLine()
+{
+    const std::string bad = "{\"id\":3,}";
+    const std::string input = "{\"id\":0}\n{\"id\":1}\n{\"id\":2}\n" + bad + "\n{\"id\":4}\n{\"id\":5}\n";
+    JsonParser reference;
+    reference.Parse(bad);
+    CHECK(reference.HasParseError());
+    for (size_t threads : kThreadCounts)
+    {
+        for (size_t chunk : kChunkSizes)
+        {
+            for (bool ordered : { true, false })
+            {
+                std::vector<Delivered> delivered = ParseLines(input, threads, chunk, ordered);
+                CHECK(delivered.size() == 6);
+                if (!ordered)
+                {
+                    std::sort(delivered.begin(), delivered.end(), [](const Delivered& a, const Delivered& b) { return a.offset < b.offset; });
+                }
+                for (size_t i = 0; i < delivered.size(); ++i)
+                {
+                    if (i == 3)
+                    {
+                        CHECK(delivered[i].error == reference.GetParseError());
+                        CHECK(delivered[i].text == bad);
+                        CHECK(delivered[i].offset == input.find(bad));
+                        CHECK(delivered[i].id == -1);
+                    }
+                    else
+                    {
+                        CHECK(delivered[i].error == JsonParseError::None);
+                        CHECK(delivered[i].id == static_cast<int64_t>(i));
+                    }
+                }
+            }
+        }
+    }
+}
+
+int main()
+{
+    TestArrays();
+    TestMalformed();
+    TestOtherRoots();
+    TestLines();
+    TestMalformedLine();
+    std::printf("ParallelTest passed\n");
+    return 0;
+}
@@ -0,0 +1,111 @@
+// Projected parsing tests. Build and run, e.g.
+//   c++ -std=c++17 -g -fsanitize=address,undefined -Iinclude tests/ProjectionTest.cpp -o projection_test && ./projection_test
+
+#include "AposaJson/AposaJson.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using namespace AposaJson;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); std::exit(1); } } while (0)
+
+static std::string Project(const std::string& json, const JsonProjection& projection)
+{
+    JsonParser parser;
+    const JsonDocument doc = parser.ParseProjected(json.data(), json.size(), projection);
+    CHECK(!parser.HasParseError());
+    return JsonSerializer().SerializeObject(doc);
+}
+
+static const char* kBody = R"({"user":{"id":7,"name":"ann","tags":["x","y"],"a/b":1,"m~n":2},"items":[{"id":1},{"id":2},{"id":3}],"meta":null})";
+
+// Nested pointers keep the values they point to and the containers on the
+// way; array elements keep their index.
+static void TestSelection()
+{
+    CHECK(Project(kBody, { "/user/id", "/user/name" }) == R"({"user":{"id":7,"name":"ann"}})");
+    CHECK(Project(kBody, { "/user/tags" }) == R"({"user":{"tags":["x","y"]}})");
+    CHECK(Project(kBody, { "/user/tags/1" }) == R"({"user":{"tags":[null,"y"]}})");
+    CHECK(Project(kBody, { "/items/1/id" }) == R"({"items":[null,{"id":2}]})");
+    CHECK(Project(kBody, { "/items/0", "/items/2/id" }) == R"({"items":[{"id":1},null,{"id":3}]})");
+    CHECK(Project(kBody, { "/user/a~1b", "/user/m~0n" }) == R"({"user":{"a/b":1,"m~n":2}})");
+    // A prefix keeps the whole subtree, and "" keeps everything.
+    CHECK(Project(kBody, { "/user", "/user/id" }) == Project(kBody, { "/user" }));
+    CHECK(Project(kBody, { "" }) == JsonSerializer().SerializeObject(JsonParser().Parse(kBody)));
+    CHECK(Project("[1,[2,3],4]", { "/1/0" }) == "[null,[2]]");
+    CHECK(Project("\"scalar root\"", { "/x" }) == "\"scalar root\"");
+
+    JsonProjection projection;
+    CHECK(!projection.Add("user"));
+    CHECK(!projection.Add("/a~2"));
+    CHECK(projection.Add("/user/name"));
+    CHECK(Project(kBody, projection) == R"({"user":{"name":"ann"}})");
+}
+
+// Paths that are not in the document select nothing beyond the containers on
+// the way; an index past the end still nulls the elements in front of it.
+static void TestMissingPaths()
+{
+    CHECK(Project(kBody, { "/nothing" }) == "{}");
+    CHECK(Project(kBody, { "/user/nothing" }) == R"({"user":{}})");
+    CHECK(Project(kBody, { "/items/9" }) == R"({"items":[null,null,null]})");
+    CHECK(Project(kBody, { "/meta/deeper" }) == "{}");
+    CHECK(Project(kBody, { "/user/name/deeper" }) == R"({"user":{}})");
+    CHECK(Project(kBody, { "/items/x" }) == R"({"items":[]})");
+    CHECK(Project(kBody, {}) == "{}");
+}
+
+// Skipped regions are checked for structure with the errors Parse reports.
+static void TestMalformedSkippedRegions()
+{
+    const char* inputs[] = {
+        R"({"user":{"x":[1,}}})",
+        R"({"user":{"x":[1}}})",
+        R"({"user":{"x":{"a":1]},"name":"n"}})",
+        R"({"user":{"x":{"a":1,}},"name":"n"}})",
+        R"({"user":{"x":{"a" 1}},"name":"n"}})",
+        R"({"user":{"x":{1:2}},"name":"n"}})",
+        R"({"user":{"x":[1 2]},"name":"n"}})",
+        R"({"user":{"x":[,]},"name":"n"}})",
+        R"({"user":{"x":[:]},"name":"n"}})",
+        R"({"user":{"x":[x]},"name":"n"}})",
+        R"({"user":{"x":[[[[]]]},"name":"n"}})",
+        R"({"user":{"x":[{"a":"unterminated]}})",
+        R"({"skipped":{"a":[1,2,{"b":}]},"user":{"name":"n"}})",
+        R"({"skipped":[1,2)",
+        R"({"skipped":)"
+    };
+    const JsonProjection projection({ "/user/name" });
+    for (const char* input : inputs)
+    {
+        const std::string json = input;
+        JsonParser reference;
+        reference.Parse(json);
+        CHECK(reference.HasParseError());
+        JsonParser parser;
+        parser.ParseProjected(json.data(), json.size(), projection);
+        CHECK(parser.GetParseError() == reference.GetParseError());
+        CHECK(parser.GetErrorOffset() == reference.GetErrorOffset());
+    }
+
+    // Nesting in skipped regions counts towards the depth limit too.
+    const std::string deep = "{\"x\":" + std::string(1100, '[') + std::string(1100, ']') + "}";
+    JsonParser reference;
+    reference.Parse(deep);
+    CHECK(reference.GetParseError() == JsonParseError::DepthExceeded);
+    JsonParser parser;
+    parser.ParseProjected(deep.data(), deep.size(), projection);
+    CHECK(parser.GetParseError() == JsonParseError::DepthExceeded);
+    CHECK(parser.GetErrorOffset() == reference.GetErrorOffset());
+}
+
+int main()
+{
+    TestSelection();
+    TestMissingPaths();
+    TestMalformedSkippedRegions();
+    std::printf("ProjectionTest passed\n");
+    return 0;
+}
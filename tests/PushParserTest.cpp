@@ -0,0 +1,160 @@
+// Chunked parsing tests. Build and run, e.g.
+//   c++ -std=c++17 -g -fsanitize=address,undefined -Iinclude tests/PushParserTest.cpp -o push_parser_test && ./push_parser_test
+
+#include "AposaJson/AposaJson.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using namespace AposaJson;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); std::exit(1); } } while (0)
+
+// Feeds json in chunks of at most chunk bytes and returns the parse error.
+static JsonParseError PushParse(const std::string& json, size_t chunk, JsonDocument& doc, size_t* error_offset = nullptr)
+{
+    JsonDocumentBuilder builder(doc);
+    JsonPushParser<JsonDocumentBuilder> parser(builder);
+    for (size_t i = 0; i < json.size(); i += chunk)
+    {
+        if (!parser.Feed(json.data() + i, std::min(chunk, json.size() - i))) break;
+    }
+    parser.Finish();
+    if (error_offset != nullptr) *error_offset = parser.GetErrorOffset();
+    return parser.GetParseError();
+}
+
+// A four-byte sequence split at any point between two chunks is accepted.
+static void TestSplitSequence()
+{
+    const std::string json = "{\"s\":\"a\xF0\x9F\x98\x80" "b\"}";
+    for (size_t split = 1; split < json.size(); ++split)
+    {
+        JsonDocument doc;
+        JsonDocumentBuilder builder(doc);
+        JsonPushParser<JsonDocumentBuilder> parser(builder);
+        CHECK(parser.Feed(json.data(), split));
+        CHECK(parser.Feed(json.data() + split, json.size() - split));
+        CHECK(parser.Finish());
+        CHECK(doc["s"].GetStringView() == "a\xF0\x9F\x98\x80" "b");
+    }
+    JsonDocument doc;
+    CHECK(PushParse(json, 1, doc) == JsonParseError::None);
+    CHECK(doc["s"].GetStringView() == "a\xF0\x9F\x98\x80" "b");
+}
+
+// Malformed UTF-8 fails with the error and offset JsonParser reports, however
+// the input is cut.
+static void TestInvalidUtf8()
+{
+    const char* inputs[] = {
+        "[\"\xff\"]",
+        "[\"\xF0\x9F\x98\"]",
+        "[\"\xF0\x9F\x98",
+        "[\"\xE2\x82\xAC\xC3\"]",
+        "[\"\xED\xA0\x80\"]",
+        "[\"\xC0\xAF\"]",
+        "[\"ok\"] \xF4\x90\x80\x80"
+    };
+    for (const char* input : inputs)
+    {
+        const std::string json = input;
+        JsonParser reference;
+        reference.Parse(json);
+        CHECK(reference.GetParseError() == JsonParseError::InvalidUtf8);
+        for (size_t chunk = 1; chunk <= json.size(); ++chunk)
+        {
+            JsonDocument doc;
+            size_t offset;
+            CHECK(PushParse(json, chunk, doc, &offset) == JsonParseError::InvalidUtf8);
+            CHECK(offset == reference.GetErrorOffset());
+        }
+    }
+}
+
+// An unescaped quote without a partner is reported at that quote, after any
+// error in front of it, by both parsers and for any chunking.
+static void TestUnterminatedString()
+{
+    const char* inputs[] = {
+        "\"",
+        "\"abc",
+        "[\"abc]",
+        "[\"\\\"]",
+        "{\"a}",
+        "{\"a\":\"b}",
+        "{\"a\":[\"b}]",
+        "[\"a\" \"b]",
+        "[1 \"a]",
+        "1 \"a"
+    };
+    for (const char* input : inputs)
+    {
+        const std::string json = input;
+        JsonParser reference;
+        reference.Parse(json);
+        CHECK(reference.HasParseError());
+        for (size_t chunk = 1; chunk <= json.size(); ++chunk)
+        {
+            JsonDocument doc;
+            size_t offset;
+            CHECK(PushParse(json, chunk, doc, &offset) == reference.GetParseError());
+            CHECK(offset == reference.GetErrorOffset());
+        }
+    }
+    JsonParser parser;
+    parser.Parse("[\"a\",\"b]");
+    CHECK(parser.GetParseError() == JsonParseError::UnterminatedString);
+    CHECK(parser.GetErrorOffset() == 5);
+}
+
+// Input longer than one index window (64 KiB) of JsonParser, with strings,
+// escapes and numbers across the window boundaries, parses like the push
+// parser parses it, and errors far into the input are reported alike.
+static void TestLongInput()
+{
+    std::string json = "[";
+    for (int i = 0; json.size() < 300000; ++i)
+    {
+        if (i != 0) json += ',';
+        json += i % 2 == 0 ? "{\"s\":\"" + std::string(i % 97, 'x') + "\\\"\\\\\",\"n\":" + std::to_string(i * 12345) + "}" : std::to_string(i) + ".5";
+    }
+    json += "]";
+    JsonParser reference;
+    const JsonDocument expected = reference.Parse(json);
+    CHECK(!reference.HasParseError());
+    JsonSerializer serializer;
+    for (size_t chunk : { size_t(4096), json.size() })
+    {
+        JsonDocument doc;
+        CHECK(PushParse(json, chunk, doc) == JsonParseError::None);
+        CHECK(serializer.SerializeObject(doc) == serializer.SerializeObject(expected));
+    }
+
+    const std::string inputs[] = {
+        json.substr(0, json.size() - 1) + ",}]",
+        json.substr(0, json.size() - 1) + ",\"never closed]",
+        json.substr(0, 200000) + "\"x\"" + json.substr(200000)
+    };
+    for (const std::string& input : inputs)
+    {
+        reference.Parse(input);
+        CHECK(reference.HasParseError());
+        JsonDocument doc;
+        size_t offset;
+        CHECK(PushParse(input, 4096, doc, &offset) == reference.GetParseError());
+        CHECK(offset == reference.GetErrorOffset());
+    }
+}
+
+int main()
+{
+    TestSplitSequence();
+    TestInvalidUtf8();
+    TestUnterminatedString();
+    TestLongInput();
+    std::printf("PushParserTest passed\n");
+    return 0;
+}
@@ -0,0 +1,86 @@
+// Validation tests. Build and run, e.g.
+//   c++ -std=c++17 -g -fsanitize=address,undefined -Iinclude tests/ValidateTest.cpp -o validate_test && ./validate_test
+
+#include "AposaJson/AposaJson.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using namespace AposaJson;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); std::exit(1); } } while (0)
+
+// Well-formed documents of every kind pass, and a failure does not stick to
+// the next call.
+static void TestValid()
+{
+    const char* inputs[] = {
+        "null", " true ", "-0.5e+3", "\"\"", "[]", "{}",
+        R"({"a":[1,2.5,-3e-2,{"b":null}],"c":"esc \" \\ \/ \b \f \n \r \t \u00e9 \ud83d\ude00","":{}})",
+        "[[[[[[[[[[\"deep\"]]]]]]]]]]",
+        "\"caf\xC3\xA9\""
+    };
+    JsonParser parser;
+    for (const char* input : inputs)
+    {
+        CHECK(parser.Validate(input));
+        CHECK(!parser.HasParseError());
+        CHECK(!parser.Validate("[1,]"));
+    }
+    CHECK(parser.Validate(std::string(500, '[') + std::string(500, ']')));
+}
+
+// Malformed documents fail with the error and offset Parse() reports.
+static void TestLikeParse()
+{
+    const char* inputs[] = {
+        "", "  ", "[1,]", "{\"a\":1,}", "[1 2]", "{\"a\" 1}", "{1:2}", "[}", "{]", "[1,2", "{\"a\":",
+        "01", "1.", "-", "1e", "+1", "1e400", "tru", "nul", "[true false]",
+        "\"abc", "[\"\\x\"]", "[\"\\u12\"]", "[\"\\ud800\"]", "[\"\\udc00x\"]",
+        "[1] 2", "\"\xff\"", "[\"\xC0\xAF\"]"
+    };
+    for (const char* input : inputs)
+    {
+        const std::string json = input;
+        JsonParser reference;
+        reference.Parse(json);
+        CHECK(reference.HasParseError());
+        JsonParser parser;
+        CHECK(!parser.Validate(json));
+        CHECK(parser.GetParseError() == reference.GetParseError());
+        CHECK(parser.GetErrorOffset() == reference.GetErrorOffset());
+    }
+
+    const std::string deep = std::string(1100, '[') + std::string(1100, ']');
+    JsonParser parser;
+    CHECK(!parser.Validate(deep));
+    CHECK(parser.GetParseError() == JsonParseError::DepthExceeded);
+}
+
+// Validate() is stricter than Parse() about the raw text of strings: control
+// characters must be escaped.
+static void TestControlCharacters()
+{
+    for (char c = 0x01; c < 0x20; ++c)
+    {
+        const std::string json = std::string("[\"ab") + c + "\"]";
+        JsonParser parser;
+        CHECK(!parser.Validate(json));
+        CHECK(parser.GetParseError() == JsonParseError::ControlCharacter);
+        CHECK(parser.GetErrorOffset() == 4);
+    }
+    JsonParser parser;
+    CHECK(!parser.Validate(std::string("{\"k\0y\":1}", 9)));
+    CHECK(parser.GetParseError() == JsonParseError::ControlCharacter);
+    CHECK(parser.Validate("[\"\x7f\"]"));
+}
+
+int main()
+{
+    TestValid();
+    TestLikeParse();
+    TestControlCharacters();
+    std::printf("ValidateTest passed\n");
+    return 0;
+}
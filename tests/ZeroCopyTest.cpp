@@ -0,0 +1,88 @@
+// Zero-copy parsing tests. Build and run under the address sanitizer, e.g.
+//   c++ -std=c++17 -g -fsanitize=address,undefined -Iinclude tests/ZeroCopyTest.cpp -o zero_copy_test && ./zero_copy_test
+
+#include "AposaJson/AposaJson.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using namespace AposaJson;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); std::exit(1); } } while (0)
+
+static bool PointsInto(std::string_view text, const std::string& input)
+{
+    return text.data() >= input.data() && text.data() + text.size() <= input.data() + input.size();
+}
+
+// Strings and keys without escapes point into the input; escaped ones are
+// decoded into the document.
+static void TestViews()
+{
+    const std::string input = R"({"plain":"no escapes here","nested":{"inner key":["element",""]},"escaped":"tab\there","key\"q":"v"})";
+    JsonParser parser;
+    const JsonDocument doc = parser.ParseZeroCopy(input.data(), input.size());
+    CHECK(!parser.HasParseError());
+
+    CHECK(PointsInto(doc.Find("plain")->GetStringView(), input));
+    CHECK(doc.Find("plain")->GetStringView() == "no escapes here");
+    CHECK(PointsInto(doc.begin()->first, input));
+    const JsonObject nested = doc.Find("nested")->GetObject();
+    CHECK(PointsInto(nested.begin()->GetKey(), input));
+    CHECK(PointsInto(nested["inner key"].GetArray()[0].GetStringView(), input));
+    CHECK(nested["inner key"].GetArray()[1].GetStringView().empty());
+
+    CHECK(!PointsInto(doc.Find("escaped")->GetStringView(), input));
+    CHECK(doc.Find("escaped")->GetStringView() == "tab\there");
+    CHECK(doc.Find("key\"q") != nullptr);
+    CHECK(doc.Find("key\"q")->GetStringView() == "v");
+}
+
+// A copy of a zero-copy document owns its text and outlives the input; the
+// document itself reads the input as it is now.
+static void TestCopyOutlivesInput()
+{
+    JsonDocument copy;
+    JsonValue value;
+    {
+        std::string input = R"({"a":"first value","b":["second value",{"c":"third value"}]})";
+        JsonParser parser;
+        const JsonDocument doc = parser.ParseZeroCopy(input.data(), input.size());
+        copy = doc;
+        value = *doc.Find("b");
+        input.assign(input.size(), '#');
+        // The keys are views as well.
+        CHECK(doc.begin()->first == "#");
+        CHECK(doc.begin()->second.GetStringView() == "###########");
+    }
+    CHECK(copy["a"].GetStringView() == "first value");
+    CHECK(copy["b"].GetArray()[1].GetObject()["c"].GetStringView() == "third value");
+    CHECK(value.GetArray()[0].GetStringView() == "second value");
+}
+
+// Zero-copy strings are not NUL-terminated: the length is all that bounds
+// them. Errors give an empty document, as with Parse().
+static void TestLengthsAndErrors()
+{
+    const std::string input = R"(["ab","abc","a"])";
+    JsonParser parser;
+    const JsonDocument doc = parser.ParseZeroCopy(input.data(), input.size());
+    CHECK(doc.GetRoot().GetArray()[0].GetStringView() == "ab");
+    CHECK(doc.GetRoot().GetArray()[0].GetStringLength() == 2);
+    CHECK(std::string(doc.GetRoot().GetArray()[2].GetStringView()) == "a");
+
+    const std::string bad = R"({"a":"b",})";
+    const JsonDocument failed = parser.ParseZeroCopy(bad.data(), bad.size());
+    CHECK(parser.GetParseError() == JsonParseError::MissingName);
+    CHECK(failed.Empty());
+}
+
+int main()
+{
+    TestViews();
+    TestCopyOutlivesInput();
+    TestLengthsAndErrors();
+    std::printf("ZeroCopyTest passed\n");
+    return 0;
+}